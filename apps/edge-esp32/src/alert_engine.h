@@ -0,0 +1,94 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+// --- Motor de alertas na borda ---
+// As mesmas regras do fn_norm no Node-RED (temp > 38 → ALTA_TEMP,
+// bpm > 120 → TAQUICARDIA), avaliadas no dispositivo a cada evento do
+// sensor em vez de a cada janela. Cada regra tem histerese: dispara com o
+// valor acima de fireAbove e só normaliza com o valor em clearAtOrBelow ou
+// menos, então um valor oscilando no limiar não gera uma rajada de
+// mensagens. update() é O(1) e só devolve um evento nas transições.
+//
+// Valores em ponto fixo: temp em °C * 100 (como a Sample), bpm * 10 (como
+// o BPM em streaming). Os limiares podem mudar em runtime de outra tarefa
+// (comando serial): o par fire/clear de cada regra fica numa palavra de 32
+// bits trocada de uma vez, então update() nunca vê um limiar novo com o
+// outro velho. update() só roda numa tarefa; status() e transitions() podem
+// ser lidos de qualquer uma.
+enum AlertRule : uint8_t { ALERT_TEMP, ALERT_BPM, ALERT_RULE_COUNT };
+
+inline const char* alertRuleName(uint8_t r) {
+  static const char* const names[ALERT_RULE_COUNT] = {"temp", "bpm"};
+  return r < ALERT_RULE_COUNT ? names[r] : "?";
+}
+
+// Bits das regras ativas -> status do fn_norm
+inline const char* alertStatusName(uint8_t active) {
+  static const char* const names[4] = {"OK", "ALTA_TEMP", "TAQUICARDIA", "ALTA_TEMP+TAQUICARDIA"};
+  return names[active & 3];
+}
+
+struct AlertEvent {
+  uint32_t ts;        // millis() da transição
+  uint32_t eventUs;   // micros() do evento do sensor (latência até o publish)
+  int32_t value;      // valor que causou a transição (ponto fixo da regra)
+  uint8_t rule;       // AlertRule
+  bool active;        // disparou (true) ou normalizou (false)
+  uint8_t status;     // bits das regras ativas depois da transição
+};
+
+class AlertEngine {
+public:
+  AlertEngine(int32_t tempFire, int32_t tempClear, int32_t bpmFire, int32_t bpmClear) {
+    configure(ALERT_TEMP, tempFire, tempClear);
+    configure(ALERT_BPM, bpmFire, bpmClear);
+  }
+
+  // false se clear > fire (sem histerese coerente) ou fora de int16
+  bool configure(uint8_t rule, int32_t fireAbove, int32_t clearAtOrBelow) {
+    if (rule >= ALERT_RULE_COUNT || clearAtOrBelow > fireAbove) return false;
+    if (fireAbove > INT16_MAX || clearAtOrBelow < INT16_MIN) return false;
+    uint32_t packed = (uint32_t)(uint16_t)fireAbove << 16 | (uint16_t)clearAtOrBelow;
+    limits_[rule].store(packed, std::memory_order_release);
+    return true;
+  }
+
+  int32_t fireAbove(uint8_t rule) const { return limitFire(limits_[rule].load(std::memory_order_acquire)); }
+  int32_t clearAtOrBelow(uint8_t rule) const {
+    return limitClear(limits_[rule].load(std::memory_order_acquire));
+  }
+
+  // Avalia um valor novo; true (e ev preenchido) só quando a regra muda
+  bool update(uint8_t rule, int32_t value, uint32_t nowMs, uint32_t eventUs, AlertEvent& ev) {
+    if (rule >= ALERT_RULE_COUNT) return false;
+    uint32_t limits = limits_[rule].load(std::memory_order_acquire);
+    uint8_t bit = (uint8_t)(1u << rule);
+    uint8_t status = active_.load(std::memory_order_relaxed);
+    bool active = (status & bit) != 0;
+    if (!active && value > limitFire(limits)) status |= bit;
+    else if (active && value <= limitClear(limits)) status &= (uint8_t)~bit;
+    else return false;
+    active_.store(status, std::memory_order_relaxed);
+    transitions_.store(transitions_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    ev.ts = nowMs;
+    ev.eventUs = eventUs;
+    ev.value = value;
+    ev.rule = rule;
+    ev.active = !active;
+    ev.status = status;
+    return true;
+  }
+
+  uint8_t status() const { return active_.load(std::memory_order_relaxed); }
+  uint32_t transitions() const { return transitions_.load(std::memory_order_relaxed); }
+
+private:
+  static int32_t limitFire(uint32_t packed) { return (int16_t)(packed >> 16); }
+  static int32_t limitClear(uint32_t packed) { return (int16_t)(packed & 0xFFFF); }
+
+  std::atomic<uint32_t> limits_[ALERT_RULE_COUNT] = {};   // fire << 16 | clear
+  std::atomic<uint8_t> active_{0};                         // bits das regras ativas
+  std::atomic<uint32_t> transitions_{0};
+};
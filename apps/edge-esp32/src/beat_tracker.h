@@ -0,0 +1,85 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// --- Estimador de BPM por intervalos entre batimentos ---
+// Recebe o timestamp (micros) de cada batimento e mantém só os que caem na
+// janela deslizante. BPM = 60e6 * (n - 1) / (último - primeiro), ou seja,
+// a média dos intervalos (IBI) da janela: resolução abaixo de 1 bpm e
+// atualização a cada batimento, em vez de pulsos * 6 em degraus de 6.
+// Custo O(1) amortizado por batimento. Usa diferenças em uint32_t, então
+// tolera o overflow de micros() (~71 min) desde que a janela seja menor.
+// N = máximo de batimentos na janela (ex.: 64 cobre 300 bpm em 10 s).
+template <size_t N>
+class BeatTracker {
+public:
+  BeatTracker(uint32_t windowUs, uint32_t refractoryUs)
+    : windowUs_(windowUs), refractoryUs_(refractoryUs) {}
+
+  // Retorna false se o batimento caiu no período refratário (bounce/ruído)
+  bool addBeat(uint32_t tUs) {
+    if (count_ > 0 && tUs - last() < refractoryUs_) return false;
+    if (count_ == N) dropOldest();
+    buf_[(head_ + count_) % N] = tUs;
+    count_++;
+    total_++;
+    expire(tUs);
+    return true;
+  }
+
+  // Remove batimentos que saíram da janela que termina em nowUs
+  void expire(uint32_t nowUs) {
+    while (count_ > 0 && nowUs - buf_[head_] > windowUs_) dropOldest();
+  }
+
+  // BPM na janela terminada em nowUs; 0 se houver menos de 2 batimentos
+  float bpm(uint32_t nowUs) {
+    expire(nowUs);
+    if (count_ < 2) return 0.0f;
+    uint32_t span = last() - buf_[head_];
+    if (span == 0) return 0.0f;
+    return 60e6f * (float)(count_ - 1) / (float)span;
+  }
+
+  // Último intervalo entre batimentos (0 se não houver)
+  uint32_t lastIbiUs() const {
+    if (count_ < 2) return 0;
+    return last() - buf_[(head_ + count_ - 2) % N];
+  }
+
+  size_t beats() const { return count_; }
+  uint32_t totalBeats() const { return total_; }
+  void setWindowUs(uint32_t windowUs) { windowUs_ = windowUs; }
+
+private:
+  uint32_t last() const { return buf_[(head_ + count_ - 1) % N]; }
+  void dropOldest() { head_ = (head_ + 1) % N; count_--; }
+
+  uint32_t buf_[N];
+  size_t head_ = 0, count_ = 0;
+  uint32_t total_ = 0;
+  uint32_t windowUs_;
+  uint32_t refractoryUs_;
+};
+
+// --- Estimador rápido para o modo streaming ---
+// Média móvel exponencial dos IBIs com peso 1/2^shift para o intervalo novo:
+// O(1) por batimento e reage em poucos batimentos (shift = 1: um salto de
+// 75 para 150 bpm já aparece como ~120 bpm no segundo batimento).
+class IbiEwma {
+public:
+  explicit IbiEwma(uint8_t shift) : shift_(shift) {}
+
+  void addIbi(uint32_t ibiUs) {
+    if (avgUs_ == 0) avgUs_ = ibiUs;
+    else avgUs_ = (uint32_t)((int32_t)avgUs_ + (((int32_t)ibiUs - (int32_t)avgUs_) >> shift_));
+  }
+
+  void reset() { avgUs_ = 0; }
+  uint32_t avgIbiUs() const { return avgUs_; }
+  float bpm() const { return avgUs_ ? 60e6f / (float)avgUs_ : 0.0f; }
+
+private:
+  uint8_t shift_;
+  uint32_t avgUs_ = 0;
+};
@@ -0,0 +1,28 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// --- CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF) ---
+inline uint16_t crc16(const void* data, size_t len, uint16_t crc = 0xFFFF) {
+  const uint8_t* p = (const uint8_t*)data;
+  while (len--) {
+    crc ^= (uint16_t)(*p++) << 8;
+    for (int i = 0; i < 8; i++) {
+      crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+// --- CRC-32 (IEEE 802.3, refletido, poly 0xEDB88320) ---
+// Mesmo resultado do esp_rom_crc32_le(0, ...) da ROM do ESP32: o firmware
+// usa halCrc32() (tabela na ROM) e esta versão fica para o host.
+inline uint32_t crc32(const void* data, size_t len) {
+  const uint8_t* p = (const uint8_t*)data;
+  uint32_t crc = 0xFFFFFFFF;
+  while (len--) {
+    crc ^= *p++;
+    for (int i = 0; i < 8; i++) crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+  }
+  return ~crc;
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "sample_agg.h"
+
+// --- Janela de entrega (at-least-once) ---
+// Até MSGS mensagens publicadas e ainda sem ack, cada uma com até BATCH
+// amostras (janelas ou agregados, sample_agg.h). Cada amostra tem um número
+// de sequência: seq da mensagem + índice. O ack é cumulativo: ack(seq)
+// libera, na ordem, toda mensagem cuja última amostra tem número <= seq
+// (comparação com wrap). Uma amostra só sai da janela confirmada; até lá
+// pode ser reenviada quantas vezes for preciso.
+template<size_t MSGS, size_t BATCH>
+class DeliveryWindow {
+public:
+  struct Msg {
+    uint32_t seq;         // seq da primeira amostra
+    uint16_t count;
+    uint16_t fromFlash;   // amostras vindas do log em flash
+    uint8_t tries;        // publishes já feitos
+    bool sent;            // enviada na conexão atual
+    uint32_t sentMs;
+    SampleRecord samples[BATCH];
+  };
+
+  explicit DeliveryWindow(uint32_t firstSeq = 0) : nextSeq_(firstSeq) {}
+
+  bool full() const { return len_ == MSGS; }
+  bool empty() const { return len_ == 0; }
+  size_t msgs() const { return len_; }
+  size_t samples() const { return samples_; }
+  size_t flashSamples() const { return flash_; }
+  uint32_t nextSeq() const { return nextSeq_; }
+  // Menor seq ainda sem ack (nextSeq() com a janela vazia)
+  uint32_t baseSeq() const { return len_ ? msgs_[head_].seq : nextSeq_; }
+
+  // Nova mensagem no fim da janela, ainda não enviada; nullptr se cheia
+  Msg* push(const SampleRecord* s, size_t n, size_t fromFlash) {
+    if (full() || n == 0 || n > BATCH) return nullptr;
+    Msg& m = msgs_[(head_ + len_) % MSGS];
+    m.seq = nextSeq_;
+    m.count = (uint16_t)n;
+    m.fromFlash = (uint16_t)fromFlash;
+    m.tries = 0;
+    m.sent = false;
+    m.sentMs = 0;
+    for (size_t i = 0; i < n; i++) m.samples[i] = s[i];
+    nextSeq_ += n;
+    len_++;
+    samples_ += n;
+    flash_ += fromFlash;
+    return &m;
+  }
+
+  // i = 0 é a mais antiga
+  Msg& at(size_t i) { return msgs_[(head_ + i) % MSGS]; }
+
+  // Ack cumulativo; devolve quantas amostras saíram. Acks de números ainda
+  // não atribuídos são ignorados.
+  size_t ack(uint32_t seq) {
+    if (len_ == 0 || (int32_t)(seq - (nextSeq_ - 1)) > 0) return 0;
+    size_t freed = 0;
+    while (len_ > 0) {
+      Msg& m = msgs_[head_];
+      if ((int32_t)(seq - (m.seq + m.count - 1)) < 0) break;
+      freed += m.count;
+      samples_ -= m.count;
+      flash_ -= m.fromFlash;
+      head_ = (head_ + 1) % MSGS;
+      len_--;
+    }
+    return freed;
+  }
+
+  // Consistência depois de um restore (retained.h)
+  bool valid() const {
+    if (head_ >= MSGS || len_ > MSGS) return false;
+    size_t samples = 0, flash = 0;
+    uint32_t seq = len_ ? msgs_[head_].seq : nextSeq_;
+    for (size_t i = 0; i < len_; i++) {
+      const Msg& m = msgs_[(head_ + i) % MSGS];
+      if (m.seq != seq || m.count == 0 || m.count > BATCH || m.fromFlash > m.count) return false;
+      seq += m.count;
+      samples += m.count;
+      flash += m.fromFlash;
+    }
+    return seq == nextSeq_ && samples == samples_ && flash == flash_;
+  }
+
+  // Conexão nova: nada do que foi enviado antes tem entrega garantida
+  void markUnsent() {
+    for (size_t i = 0; i < len_; i++) at(i).sent = false;
+  }
+
+private:
+  Msg msgs_[MSGS];
+  size_t head_ = 0;
+  size_t len_ = 0;
+  size_t samples_ = 0;
+  size_t flash_ = 0;
+  uint32_t nextSeq_;
+};
@@ -0,0 +1,60 @@
+#include "dht_async.h"
+#include "hal.h"
+
+enum DhtPhase : uint8_t { DHT_IDLE, DHT_START, DHT_CAPTURE };
+
+static uint8_t dhtPin = 0;
+static DhtPhase dhtPhase = DHT_IDLE;
+static uint32_t dhtCounts[DHT_STATUS_COUNT];
+
+// Escritos só pela ISR durante a captura; lidos depois do detach
+static volatile uint32_t dhtFalls[DHT_EDGES];
+static volatile uint8_t dhtFallCount = 0;
+
+static void IRAM_ATTR dhtOnFall() {
+  uint8_t n = dhtFallCount;
+  if (n < DHT_EDGES) dhtFalls[n] = micros();
+  if (n < 0xFF) dhtFallCount = n + 1;   // bordas a mais contam (glitch)
+}
+
+void dhtAsyncBegin(uint8_t pin) {
+  dhtPin = pin;
+  pinMode(pin, INPUT_PULLUP);   // linha em repouso: HIGH
+}
+
+uint32_t dhtAsyncStep(DhtReading& out) {
+  switch (dhtPhase) {
+    case DHT_IDLE:
+      pinMode(dhtPin, OUTPUT);
+      digitalWrite(dhtPin, LOW);
+      dhtPhase = DHT_START;
+      return DHT_START_LOW_MS;
+
+    case DHT_START:
+      // ISR antes de soltar: a resposta começa 20-40 µs depois, e a subida
+      // da própria liberação não dispara em FALLING
+      dhtFallCount = 0;
+      attachInterrupt(digitalPinToInterrupt(dhtPin), dhtOnFall, FALLING);
+      pinMode(dhtPin, INPUT_PULLUP);
+      dhtPhase = DHT_CAPTURE;
+      return DHT_CAPTURE_MS;
+
+    case DHT_CAPTURE:
+    default: {
+      detachInterrupt(digitalPinToInterrupt(dhtPin));
+      dhtPhase = DHT_IDLE;
+      uint32_t falls[DHT_EDGES];
+      size_t n = dhtFallCount;
+      for (size_t i = 0; i < DHT_EDGES; i++) falls[i] = dhtFalls[i];
+      out.temperature = NAN;
+      out.humidity = NAN;
+      out.status = dhtDecode(falls, n, out.temperature, out.humidity);
+      dhtCounts[out.status]++;
+      return 0;
+    }
+  }
+}
+
+bool dhtAsyncBusy() { return dhtPhase != DHT_IDLE; }
+
+uint32_t dhtAsyncCount(DhtStatus status) { return status < DHT_STATUS_COUNT ? dhtCounts[status] : 0; }
@@ -0,0 +1,39 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "dht_decode.h"
+
+// --- Leitura assíncrona do DHT22 ---
+// A leitura do DHTesp faz bit-banging do protocolo com as interrupções
+// mascaradas por ~5 ms, o que atrasa (ou perde) bordas do botão. Aqui a
+// leitura vira uma máquina de estados em três passos, nenhum bloqueante:
+//   1. start: puxa a linha para LOW;
+//   2. depois de DHT_START_LOW_MS, arma a ISR de borda de descida e solta a
+//      linha (pull-up); a ISR só grava o micros() de cada descida;
+//   3. depois de DHT_CAPTURE_MS, desarma a ISR e decodifica (dht_decode.h).
+// Quem chama agenda os passos (no firmware, jobs da agenda de
+// sensoriamento). A ISR custa poucos µs por borda e não mascara nada.
+//
+// Captura por GPIO em vez do RMT: usa só attachInterrupt(), então a mesma
+// máquina de estados roda na HAL simulada, que reproduz a forma de onda do
+// sensor (gerada ou gravada) no pino.
+#ifndef DHT_START_LOW_MS
+#define DHT_START_LOW_MS 2   // datasheet: >= 1 ms (granularidade do millis())
+#endif
+#ifndef DHT_CAPTURE_MS
+#define DHT_CAPTURE_MS 8     // resposta + 40 bits: ~5 ms no pior caso
+#endif
+
+struct DhtReading {
+  float temperature;
+  float humidity;
+  DhtStatus status;
+};
+
+void dhtAsyncBegin(uint8_t pin);
+// Executa o próximo passo. Devolve em quantos ms chamar de novo, ou 0 quando
+// a leitura terminou (resultado em out).
+uint32_t dhtAsyncStep(DhtReading& out);
+bool dhtAsyncBusy();
+// Leituras terminadas por resultado, desde o boot
+uint32_t dhtAsyncCount(DhtStatus status);
@@ -0,0 +1,69 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// --- Decodificador do protocolo do DHT22 ---
+// Depois do pulso de start, o sensor responde com 80 µs em LOW e 80 µs em
+// HIGH e manda 40 bits, cada um com 50 µs em LOW seguidos de 26-28 µs (0)
+// ou 70 µs (1) em HIGH. Só as bordas de descida são capturadas: a primeira
+// abre a resposta, a segunda fecha a resposta, e as outras 40 fecham cada
+// bit. O intervalo entre descidas é ~76 µs para 0 e ~120 µs para 1, então
+// o bit sai do intervalo e não de uma largura de pulso medida pela CPU.
+//
+// Uma borda perdida deixa 41 descidas e junta dois bits num intervalo
+// longo; um glitch deixa 43 e gera um intervalo curto. Os dois casos viram
+// erro em vez de um valor errado. Os limites de intervalo têm folga para o
+// jitter do sensor e da latência da ISR; a contagem pega o resto.
+static const size_t DHT_EDGES = 42;
+static const uint32_t DHT_RESPONSE_MIN_US = 100;   // 80 + 80 nominal
+static const uint32_t DHT_RESPONSE_MAX_US = 240;
+static const uint32_t DHT_BIT_MIN_US = 40;         // 50 + 26 nominal para 0
+static const uint32_t DHT_BIT_MAX_US = 200;        // 50 + 70 nominal para 1
+static const uint32_t DHT_BIT_ONE_US = 98;         // acima disso, bit 1
+
+enum DhtStatus : uint8_t {
+  DHT_OK,
+  DHT_ERR_NO_RESPONSE,   // nenhuma borda (sensor ausente ou start perdido)
+  DHT_ERR_MISSED,        // bordas a menos ou intervalo longo (borda perdida)
+  DHT_ERR_TIMING,        // bordas a mais ou intervalo curto (glitch)
+  DHT_ERR_CHECKSUM,
+  DHT_ERR_RANGE,         // checksum bateu, mas fora da faixa do DHT22
+  DHT_STATUS_COUNT
+};
+
+inline const char* dhtStatusName(DhtStatus s) {
+  static const char* const names[DHT_STATUS_COUNT] = {"ok", "sem_resposta", "borda_perdida",
+                                                       "tempo", "checksum", "faixa"};
+  return s < DHT_STATUS_COUNT ? names[s] : "?";
+}
+
+// fallUs: micros() de cada borda de descida, em ordem (diferenças em uint32_t,
+// tolera a volta do micros()). Em DHT_OK preenche temperatura (°C) e umidade (%).
+inline DhtStatus dhtDecode(const uint32_t* fallUs, size_t n, float& temperature, float& humidity) {
+  if (n == 0) return DHT_ERR_NO_RESPONSE;
+  size_t check = n < DHT_EDGES ? n : DHT_EDGES;
+  for (size_t i = 1; i < check; i++) {
+    uint32_t d = fallUs[i] - fallUs[i - 1];
+    uint32_t lo = i == 1 ? DHT_RESPONSE_MIN_US : DHT_BIT_MIN_US;
+    uint32_t hi = i == 1 ? DHT_RESPONSE_MAX_US : DHT_BIT_MAX_US;
+    if (d > hi) return DHT_ERR_MISSED;
+    if (d < lo) return DHT_ERR_TIMING;
+  }
+  if (n < DHT_EDGES) return DHT_ERR_MISSED;
+  if (n > DHT_EDGES) return DHT_ERR_TIMING;
+
+  uint8_t b[5] = {0, 0, 0, 0, 0};
+  for (size_t bit = 0; bit < 40; bit++) {
+    uint32_t d = fallUs[bit + 2] - fallUs[bit + 1];
+    b[bit / 8] = (uint8_t)((b[bit / 8] << 1) | (d > DHT_BIT_ONE_US ? 1 : 0));
+  }
+  if ((uint8_t)(b[0] + b[1] + b[2] + b[3]) != b[4]) return DHT_ERR_CHECKSUM;
+
+  // O checksum é uma soma de 8 bits: com bits trocados aos pares ainda bate
+  uint16_t h = (uint16_t)((b[0] << 8) | b[1]);
+  uint16_t t = (uint16_t)(((b[2] & 0x7F) << 8) | b[3]);
+  if (h > 1000 || t > ((b[2] & 0x80) ? 400 : 800)) return DHT_ERR_RANGE;
+  humidity = (float)h / 10.0f;
+  temperature = (b[2] & 0x80) ? -(float)t / 10.0f : (float)t / 10.0f;
+  return DHT_OK;
+}
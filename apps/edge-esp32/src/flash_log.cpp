@@ -0,0 +1,197 @@
+#include "flash_log.h"
+#include <string.h>
+#include "crc.h"
+
+static const uint32_t FLASH_LOG_MAGIC = 0x43514C31; // "CQL1"
+static const char* FLASH_LOG_META = "meta.bin";
+
+void FlashLog::segName(char* out, size_t cap, uint32_t seg) {
+  snprintf(out, cap, "%08lu.seg", (unsigned long)seg);
+}
+
+bool FlashLog::writeMeta() {
+  Meta m;
+  m.magic = FLASH_LOG_MAGIC;
+  m.readSeg = headSeg_;
+  m.readRec = headRec_;
+  m.lastSeg = lastSeg_;
+  m.crc = crc16(&m, offsetof(Meta, crc));
+  metaDirty_ = false;
+  return st_.replace(FLASH_LOG_META, &m, sizeof(m));
+}
+
+bool FlashLog::begin() {
+  ready_ = false;
+  if (!st_.begin()) return false;
+
+  Meta m;
+  bool valid = st_.read(FLASH_LOG_META, 0, &m, sizeof(m)) == sizeof(m) &&
+               m.magic == FLASH_LOG_MAGIC &&
+               m.crc == crc16(&m, offsetof(Meta, crc)) &&
+               m.lastSeg >= m.readSeg &&
+               m.lastSeg - m.readSeg < FLASH_LOG_MAX_SEGMENTS;
+  if (valid) {
+    headSeg_ = m.readSeg;
+    headRec_ = m.readRec;
+    lastSeg_ = m.lastSeg;
+  } else {
+    headSeg_ = headRec_ = lastSeg_ = 0;
+  }
+
+  // Índice: um stat por segmento. Segmento ausente conta como vazio.
+  memset(counts_, 0, sizeof(counts_));
+  sealed_ = false;
+  for (uint32_t seg = headSeg_; seg <= lastSeg_; seg++) {
+    char name[16]; segName(name, sizeof(name), seg);
+    long bytes = st_.size(name);
+    if (bytes < 0) bytes = 0;
+    size_t recs = (size_t)bytes / RECORD_SIZE;
+    if (recs > FLASH_LOG_SEG_RECORDS) recs = FLASH_LOG_SEG_RECORDS;
+    count(seg) = (uint16_t)recs;
+    // Escrita interrompida no meio de um registro: não anexar mais neste segmento
+    if (seg == lastSeg_ && (size_t)bytes % RECORD_SIZE != 0) sealed_ = true;
+  }
+  if (headRec_ > count(headSeg_)) headRec_ = count(headSeg_);
+  // O que não foi confirmado volta a ser lido
+  readSeg_ = headSeg_;
+  readRec_ = headRec_;
+  cacheLen_ = 0;
+
+  ready_ = valid || writeMeta();
+  return ready_;
+}
+
+size_t FlashLog::size() const {
+  if (!ready_) return 0;
+  size_t total = 0;
+  for (uint32_t seg = readSeg_; seg <= lastSeg_; seg++) total += count(seg);
+  return total - readRec_;
+}
+
+void FlashLog::dropSegment(uint32_t seg) {
+  char name[16]; segName(name, sizeof(name), seg);
+  st_.remove(name);
+  count(seg) = 0;
+}
+
+bool FlashLog::rotate() {
+  if (lastSeg_ - headSeg_ + 1 >= FLASH_LOG_MAX_SEGMENTS) {
+    // Sem espaço: descarta o segmento mais antigo inteiro. O que já foi
+    // lido dele segue na entrega, só perde a cópia em flash.
+    if (readSeg_ == headSeg_) {
+      dropped_ += count(readSeg_) - readRec_;
+      readSeg_++;
+      readRec_ = 0;
+      cacheLen_ = 0;
+    }
+    dropSegment(headSeg_);
+    headSeg_++;
+    headRec_ = 0;
+  }
+  lastSeg_++;
+  count(lastSeg_) = 0;
+  sealed_ = false;
+  // Metadados antes do arquivo novo: um segmento nunca fica fora do índice
+  return writeMeta();
+}
+
+bool FlashLog::append(const Sample* samples, size_t n) {
+  if (!ready_) return false;
+  uint8_t buf[FLASH_LOG_CACHE * RECORD_SIZE];
+  while (n > 0) {
+    if (sealed_ || count(lastSeg_) >= FLASH_LOG_SEG_RECORDS) {
+      if (!rotate()) return false;
+    }
+    size_t room = FLASH_LOG_SEG_RECORDS - count(lastSeg_);
+    size_t k = n < room ? n : room;
+    if (k > FLASH_LOG_CACHE) k = FLASH_LOG_CACHE;
+    for (size_t i = 0; i < k; i++) {
+      uint8_t* rec = buf + i * RECORD_SIZE;
+      memcpy(rec, &samples[i], sizeof(Sample));
+      uint16_t c = crc16(rec, sizeof(Sample));
+      rec[sizeof(Sample)] = (uint8_t)(c & 0xFF);
+      rec[sizeof(Sample) + 1] = (uint8_t)(c >> 8);
+    }
+    char name[16]; segName(name, sizeof(name), lastSeg_);
+    if (!st_.append(name, buf, k * RECORD_SIZE)) {
+      // Estado do arquivo desconhecido: fecha o segmento e segue no próximo
+      sealed_ = true;
+      return false;
+    }
+    count(lastSeg_) += (uint16_t)k;
+    samples += k;
+    n -= k;
+  }
+  return true;
+}
+
+bool FlashLog::peek(Sample& out) {
+  if (!ready_) return false;
+  for (;;) {
+    if (readRec_ >= count(readSeg_)) {
+      if (readSeg_ == lastSeg_) return false;
+      // Segmento lido: avança (o arquivo só sai no commit)
+      readSeg_++;
+      readRec_ = 0;
+      continue;
+    }
+    if (cacheLen_ == 0 || cacheSeg_ != readSeg_ ||
+        readRec_ < cacheStart_ || readRec_ >= cacheStart_ + cacheLen_) {
+      char name[16]; segName(name, sizeof(name), readSeg_);
+      size_t want = count(readSeg_) - readRec_;
+      if (want > FLASH_LOG_CACHE) want = FLASH_LOG_CACHE;
+      size_t got = st_.read(name, readRec_ * RECORD_SIZE, cache_, want * RECORD_SIZE);
+      cacheSeg_ = readSeg_;
+      cacheStart_ = readRec_;
+      cacheLen_ = got / RECORD_SIZE;
+      if (cacheLen_ == 0) {
+        // Segmento ilegível: conta como perdido e segue
+        corrupted_ += count(readSeg_) - readRec_;
+        readRec_ = count(readSeg_);
+        continue;
+      }
+    }
+    const uint8_t* rec = cache_ + (readRec_ - cacheStart_) * RECORD_SIZE;
+    uint16_t c = (uint16_t)(rec[sizeof(Sample)] | (rec[sizeof(Sample) + 1] << 8));
+    if (c != crc16(rec, sizeof(Sample))) {
+      corrupted_++;
+      readRec_++;
+      continue;
+    }
+    memcpy(&out, rec, sizeof(Sample));
+    return true;
+  }
+}
+
+void FlashLog::pop() {
+  if (!ready_ || readRec_ >= count(readSeg_)) return;
+  readRec_++;
+}
+
+void FlashLog::commit(size_t keep) {
+  if (!ready_) return;
+  // Posição nova: keep registros antes do cursor de leitura
+  uint32_t seg = readSeg_, rec = readRec_;
+  while (keep > rec && seg > headSeg_) {
+    keep -= rec;
+    rec = count(--seg);
+  }
+  rec = keep < rec ? rec - (uint32_t)keep : 0;
+  if (seg == headSeg_ && rec < headRec_) rec = headRec_;
+  // Segmentos inteiros antes da posição nova já foram entregues
+  if (seg != headSeg_ || rec != headRec_) {
+    for (; headSeg_ < seg; headSeg_++) dropSegment(headSeg_);
+    headRec_ = rec;
+    metaDirty_ = true;
+  }
+  if (headSeg_ == readSeg_ && headRec_ == readRec_ && readRec_ == count(readSeg_) && readSeg_ == lastSeg_ &&
+      count(readSeg_) > 0) {
+    // Log vazio: libera o último segmento e recomeça em um novo
+    dropSegment(readSeg_);
+    readSeg_ = headSeg_ = ++lastSeg_;
+    readRec_ = headRec_ = 0;
+    sealed_ = false;
+    metaDirty_ = true;
+  }
+  if (metaDirty_) writeMeta();
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "sample.h"
+#include "log_storage.h"
+
+// --- Log persistente de amostras (spillover da fila em RAM) ---
+// Append-only, em segmentos de tamanho fixo com rotação. Cada registro é a
+// Sample binária + CRC16, então a quantidade de registros de um segmento sai
+// direto do tamanho do arquivo. Um arquivo de metadados (cursor de leitura e
+// último segmento) torna a recuperação no boot O(segmentos): nada é lido
+// além de um stat por segmento.
+//
+// Dois cursores: o de leitura (peek/pop, só em RAM) e o confirmado
+// (commit, gravado nos metadados). Segmentos só são apagados no commit(),
+// até a posição confirmada; o que foi lido e ainda está num lote ou na
+// janela de entrega continua na flash.
+//
+// Garantia: pelo menos uma vez. Se reiniciar antes de commit(), as amostras
+// já publicadas desde o último commit são reenviadas.
+
+static const size_t FLASH_LOG_SEG_RECORDS = 256;   // registros por segmento (~3,3 KB)
+static const size_t FLASH_LOG_MAX_SEGMENTS = 64;   // ~16k amostras (~45h em janelas de 10s)
+static const size_t FLASH_LOG_CACHE = 16;          // registros lidos por acesso
+
+class FlashLog {
+public:
+  explicit FlashLog(LogStorage& storage) : st_(storage) {}
+
+  // Monta o índice a partir dos metadados. Retorna false se o storage falhar.
+  bool begin();
+  // Acrescenta n amostras (mais novas que as já gravadas)
+  bool append(const Sample* samples, size_t n);
+  // Amostra mais antiga ainda não lida (sem remover nem apagar nada da
+  // flash). Ignora registros corrompidos.
+  bool peek(Sample& out);
+  void pop();
+  // Confirma o que já saiu por pop(), menos os keep registros mais recentes
+  // (ainda sem entrega confirmada): grava a posição e apaga os segmentos
+  // consumidos. A posição confirmada nunca volta.
+  void commit(size_t keep = 0);
+
+  bool ready() const { return ready_; }
+  size_t size() const;
+  uint32_t dropped() const { return dropped_; }     // descartadas por falta de espaço
+  uint32_t corrupted() const { return corrupted_; } // registros com CRC inválido
+
+  static const size_t RECORD_SIZE = sizeof(Sample) + 2;
+
+private:
+  struct Meta {
+    uint32_t magic;
+    uint32_t readSeg;
+    uint32_t readRec;
+    uint32_t lastSeg;
+    uint16_t crc;
+  } __attribute__((packed));
+
+  static void segName(char* out, size_t cap, uint32_t seg);
+  uint16_t& count(uint32_t seg) { return counts_[seg % FLASH_LOG_MAX_SEGMENTS]; }
+  uint16_t count(uint32_t seg) const { return counts_[seg % FLASH_LOG_MAX_SEGMENTS]; }
+  bool writeMeta();
+  bool rotate();
+  void dropSegment(uint32_t seg);
+
+  LogStorage& st_;
+  bool ready_ = false;
+  bool sealed_ = false;          // último segmento com cauda parcial: não anexar
+  bool metaDirty_ = false;
+  uint32_t headSeg_ = 0, headRec_ = 0;   // posição confirmada (metadados)
+  uint32_t readSeg_ = 0, readRec_ = 0;   // cursor de leitura, >= head
+  uint32_t lastSeg_ = 0;
+  uint16_t counts_[FLASH_LOG_MAX_SEGMENTS] = {0};
+  uint32_t dropped_ = 0, corrupted_ = 0;
+
+  // cache de leitura (registros brutos de readSeg_)
+  uint8_t cache_[FLASH_LOG_CACHE * RECORD_SIZE];
+  uint32_t cacheSeg_ = 0, cacheStart_ = 0, cacheLen_ = 0;
+};
@@ -0,0 +1,84 @@
+#pragma once
+
+// --- Camada de abstração de hardware ---
+// No ESP32 (ARDUINO definido) usa o framework e as bibliotecas reais. No
+// ambiente [env:native] usa a HAL simulada (hal_native.h): relógio virtual,
+// GPIO, DHT, WiFi e MQTT em memória, para rodar setup()/loop() no Linux de
+// forma determinística.
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <DHTesp.h>
+#include <WiFi.h>
+#include <WiFiClientSecure.h>
+#include <PubSubClient.h>
+#include <LittleFS.h>
+#include <esp_attr.h>
+#include <esp_rom_crc.h>
+#include "log_storage.h"
+
+// Armazenamento do log persistente: LittleFS na partição de dados
+inline bool halFsBegin() { return LittleFS.begin(true); }
+inline LogStorage& halLogStorage() {
+  static FsLogStorage storage(LittleFS, "/q");
+  return storage;
+}
+
+// Tasks do FreeRTOS (stack em bytes no ESP-IDF). Uma task que termina chama
+// halEndTask() em vez de retornar.
+inline bool halStartTask(void (*fn)(void*), const char* name, uint32_t stackBytes,
+                         int priority, int core) {
+  return xTaskCreatePinnedToCore(fn, name, stackBytes, nullptr, priority, nullptr, core) == pdPASS;
+}
+inline void halEndTask() { vTaskDelete(NULL); }
+
+// Memória que sobrevive a reset por software, panic e watchdog (.noinit da
+// DRAM: o boot não zera). A RTC_NOINIT (8 KB) não comporta o backlog. Num
+// brownout ou power-on o conteúdo é lixo: quem usa valida (retained.h).
+#define HAL_NOINIT __NOINIT_ATTR
+
+// CRC-32 da ROM (tabela), igual ao crc32() de crc.h
+inline uint32_t halCrc32(const void* data, size_t len) {
+  return esp_rom_crc32_le(0, (const uint8_t*)data, len);
+}
+
+// Número aleatório do hardware (RNG do ESP32)
+inline uint32_t halRandom() { return esp_random(); }
+
+// Contador de ciclos da CPU (CCOUNT do Xtensa, volta a cada ~18 s a 240 MHz)
+inline uint32_t halCycleCount() { return ESP.getCycleCount(); }
+inline uint32_t halCpuMhz() { return ESP.getCpuFreqMHz(); }
+
+// Seção crítica curta entre tasks e núcleos (spinlock do FreeRTOS). Não
+// chamar nada que bloqueie ou use o UART dentro dela.
+class HalLock {
+public:
+  void lock() { portENTER_CRITICAL(&mux_); }
+  void unlock() { portEXIT_CRITICAL(&mux_); }
+private:
+  portMUX_TYPE mux_ = portMUX_INITIALIZER_UNLOCKED;
+};
+
+// Evento para acordar uma task bloqueada (semáforo binário): wait() dorme até
+// um signal() ou o timeout; um signal() antes do wait() não se perde. Com
+// todas as tasks bloqueadas a CPU fica na idle task (waiti, clock parado).
+class HalEvent {
+public:
+  HalEvent() : sem_(xSemaphoreCreateBinaryStatic(&buf_)) {}
+  void wait(uint32_t timeoutMs) { xSemaphoreTake(sem_, pdMS_TO_TICKS(timeoutMs)); }
+  void signal() { xSemaphoreGive(sem_); }
+  void IRAM_ATTR signalFromIsr() {
+    BaseType_t woken = pdFALSE;
+    xSemaphoreGiveFromISR(sem_, &woken);
+    if (woken) portYIELD_FROM_ISR();
+  }
+private:
+  StaticSemaphore_t buf_;
+  SemaphoreHandle_t sem_;
+};
+
+// Chamado (na task de eventos do UART) quando chegam bytes no Serial
+inline void halOnSerialReceive(void (*fn)()) { Serial.onReceive(fn); }
+#else
+#include "hal_native.h"
+#endif
@@ -0,0 +1,569 @@
+#ifndef ARDUINO
+#include "hal_native.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <random>
+#include <thread>
+
+// --- Estado da simulação ---
+namespace {
+
+struct PinState {
+  int level = LOW;
+  void (*isr)() = nullptr;
+  int mode = CHANGE;
+  uint8_t ioMode = INPUT;
+  bool dht = false;   // DHT22 ligado (sim::attachDht)
+};
+
+struct SimEvent {
+  uint64_t atUs;
+  std::function<void()> fire;
+};
+
+std::atomic<uint64_t> g_nowUs{0};
+
+// Tasks em segundo plano andam em passo com o relógio virtual: o loop
+// principal só segue depois que cada task ativa terminou ou está parada
+// esperando um instante futuro (custo simulado em spendUs).
+struct SimTask {
+  uint64_t wakeUs = 0;
+  bool waiting = false;
+};
+std::mutex g_taskMutex;
+std::condition_variable g_taskCv;
+std::vector<SimTask*> g_tasks;
+int g_tasksRunning = 0;
+thread_local SimTask* t_task = nullptr;
+
+void waitTasksIdle(std::unique_lock<std::mutex>& lock) {
+  g_taskCv.wait(lock, [] { return g_tasksRunning == 0; });
+}
+
+void wakeTasksUntil(uint64_t us) {
+  std::unique_lock<std::mutex> lock(g_taskMutex);
+  for (SimTask* t : g_tasks) {
+    if (t->waiting && t->wakeUs <= us) {
+      t->waiting = false;
+      g_tasksRunning++;
+    }
+  }
+  g_taskCv.notify_all();
+  waitTasksIdle(lock);
+}
+std::map<uint8_t, PinState> g_pins;
+std::vector<SimEvent> g_events;   // ordenado por atUs
+std::deque<char> g_serialIn;
+void (*g_serialReceive)() = nullptr;
+bool g_serialEcho = true;
+
+float g_dhtTemp = 36.5f, g_dhtHum = 55.0f;
+uint32_t g_dhtCostUs = 0;
+std::vector<std::vector<uint32_t>> g_dhtWaves;
+size_t g_dhtNextWave = 0;
+uint32_t g_dhtJitterUs = 0;
+double g_dhtMissPct = 0;
+std::mt19937 g_dhtRng(1);   // semente fixa: execuções reproduzíveis
+
+bool g_wifiAvailable = true;
+bool g_wifiBegun = false;
+
+bool g_mqttAvailable = true;
+bool g_mqttConnected = false;
+uint32_t g_mqttConnectCostUs = 0;
+uint32_t g_mqttPublishCostUs = 0;
+std::vector<sim::Message> g_published;
+
+// Link MQTT: mensagens no fio (atUs = chegada) e assinaturas da sessão
+uint32_t g_linkDelayUs = 0;
+std::deque<sim::Message> g_toBroker;
+std::deque<sim::Message> g_toClient;
+std::vector<std::string> g_subscriptions;
+void (*g_brokerHook)(const sim::Message&) = nullptr;
+void (*g_publishHook)(const char* topic) = nullptr;
+
+void linkDown() {
+  g_mqttConnected = false;
+  g_toBroker.clear();
+  g_toClient.clear();
+  g_subscriptions.clear();
+}
+
+void sendToBroker(const std::string& topic, const uint8_t* payload, size_t len) {
+  if (g_publishHook) g_publishHook(topic.c_str());
+  g_published.push_back(sim::Message{topic, std::vector<uint8_t>(payload, payload + len), g_nowUs});
+  g_toBroker.push_back(sim::Message{topic, g_published.back().payload, g_nowUs + g_linkDelayUs});
+}
+
+void brokerReceiveUntil(uint64_t us) {
+  while (!g_toBroker.empty() && g_toBroker.front().atUs <= us) {
+    sim::Message msg = g_toBroker.front();
+    g_toBroker.pop_front();
+    if (g_brokerHook) g_brokerHook(msg);
+  }
+}
+
+void fireEventsUntil(uint64_t us) {
+  while (!g_events.empty() && g_events.front().atUs <= us) {
+    SimEvent ev = g_events.front();
+    g_events.erase(g_events.begin());
+    g_nowUs = ev.atUs;
+    ev.fire();
+  }
+}
+
+// Próximo instante em que algo acontece na simulação (evento agendado, task
+// acordando, mensagem chegando ao broker), limitado a limitUs
+uint64_t nextActivityUs(uint64_t limitUs) {
+  uint64_t next = limitUs;
+  if (!g_events.empty()) next = std::min(next, g_events.front().atUs);
+  if (!g_toBroker.empty()) next = std::min(next, g_toBroker.front().atUs);
+  std::lock_guard<std::mutex> lock(g_taskMutex);
+  for (SimTask* t : g_tasks) {
+    if (t->waiting) next = std::min(next, t->wakeUs);
+  }
+  return next;
+}
+
+void scheduleEvent(SimEvent ev) {
+  if (ev.atUs < g_nowUs) ev.atUs = g_nowUs;  // no passado: dispara já
+  auto it = g_events.begin();
+  while (it != g_events.end() && it->atUs <= ev.atUs) ++it;
+  g_events.insert(it, std::move(ev));
+}
+
+// Custo de operações bloqueantes simuladas (DHT, TLS, publish). Numa task
+// de segundo plano, espera o relógio virtual em vez de avançá-lo.
+void spendUs(uint32_t us) {
+  if (!us) return;
+  if (!t_task) {
+    sim::advanceUs(us);
+    return;
+  }
+  std::unique_lock<std::mutex> lock(g_taskMutex);
+  t_task->wakeUs = g_nowUs + us;
+  t_task->waiting = true;
+  g_tasksRunning--;
+  g_taskCv.notify_all();
+  g_taskCv.wait(lock, [] { return !t_task->waiting; });
+}
+
+} // namespace
+
+// --- Tempo ---
+uint32_t millis() { return (uint32_t)(g_nowUs / 1000); }
+uint32_t micros() { return (uint32_t)g_nowUs; }
+void delay(uint32_t ms) { sim::advanceUs((uint64_t)ms * 1000); }
+void delayMicroseconds(uint32_t us) { sim::advanceUs(us); }
+
+// --- Eventos ---
+void HalEvent::wait(uint32_t timeoutMs) {
+  uint64_t untilUs = g_nowUs + (uint64_t)timeoutMs * 1000;
+  while (!signaled_.exchange(false)) {
+    if (g_nowUs >= untilUs) return;
+    if (t_task) {
+      // Numa task, espera o loop principal levar o relógio adiante
+      spendUs((uint32_t)std::min<uint64_t>(untilUs - g_nowUs, 1000));
+      continue;
+    }
+    uint64_t next = nextActivityUs(untilUs);
+    sim::advanceUs(next > g_nowUs ? next - g_nowUs : 0);
+  }
+}
+
+void halOnSerialReceive(void (*fn)()) { g_serialReceive = fn; }
+
+// --- GPIO ---
+namespace {
+void startDhtResponse(uint8_t pin);
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  PinState& p = g_pins[pin];
+  bool released = p.dht && p.ioMode == OUTPUT && mode != OUTPUT;
+  p.ioMode = mode;
+  if (!released) return;
+  int startLevel = p.level;
+  sim::setPin(pin, HIGH);   // pull-up
+  if (startLevel == LOW) startDhtResponse(pin);
+}
+
+int digitalRead(uint8_t pin) { return g_pins[pin].level; }
+void digitalWrite(uint8_t pin, uint8_t level) { g_pins[pin].level = level; }
+
+void attachInterrupt(uint8_t pin, void (*isr)(), int mode) {
+  g_pins[pin].isr = isr;
+  g_pins[pin].mode = mode;
+}
+
+void detachInterrupt(uint8_t pin) { g_pins[pin].isr = nullptr; }
+
+// --- Serial ---
+SimSerial Serial;
+
+int SimSerial::available() { return (int)g_serialIn.size(); }
+
+int SimSerial::read() {
+  if (g_serialIn.empty()) return -1;
+  char c = g_serialIn.front();
+  g_serialIn.pop_front();
+  return (unsigned char)c;
+}
+
+size_t SimSerial::write(uint8_t c) {
+  if (g_serialEcho) fputc(c, stdout);
+  return 1;
+}
+
+size_t SimSerial::write(const uint8_t* buf, size_t len) {
+  if (g_serialEcho) fwrite(buf, 1, len, stdout);
+  return len;
+}
+
+size_t SimSerial::print(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+size_t SimSerial::print(char c) { return write((uint8_t)c); }
+
+size_t SimSerial::print(long v) {
+  char buf[24];
+  snprintf(buf, sizeof(buf), "%ld", v);
+  return print(buf);
+}
+
+size_t SimSerial::print(unsigned long v) {
+  char buf[24];
+  snprintf(buf, sizeof(buf), "%lu", v);
+  return print(buf);
+}
+
+size_t SimSerial::print(double v, int digits) {
+  char buf[40];
+  snprintf(buf, sizeof(buf), "%.*f", digits, v);
+  return print(buf);
+}
+
+SimEsp ESP;
+
+// --- DHT ---
+TempAndHumidity DHTesp::getTempAndHumidity() {
+  spendUs(g_dhtCostUs);
+  return TempAndHumidity{g_dhtTemp, g_dhtHum};
+}
+
+// Forma de onda do DHT22 para temperatura/umidade: HIGH antes da resposta,
+// resposta (80 µs LOW, 80 µs HIGH), 40 bits (50 µs LOW + 26 ou 70 µs HIGH)
+// e os 50 µs LOW finais antes de soltar a linha
+namespace {
+std::vector<uint32_t> dhtWaveform(float temperature, float humidity) {
+  uint16_t h = (uint16_t)lroundf(humidity * 10.0f);
+  uint16_t t = (uint16_t)lroundf(fabsf(temperature) * 10.0f);
+  if (temperature < 0) t |= 0x8000;
+  uint8_t b[5] = {(uint8_t)(h >> 8), (uint8_t)h, (uint8_t)(t >> 8), (uint8_t)t, 0};
+  b[4] = (uint8_t)(b[0] + b[1] + b[2] + b[3]);
+  std::vector<uint32_t> wave = {30, 80, 80};
+  for (int bit = 0; bit < 40; bit++) {
+    wave.push_back(50);
+    wave.push_back((b[bit / 8] >> (7 - bit % 8)) & 1 ? 70 : 26);
+  }
+  wave.push_back(50);
+  return wave;
+}
+
+// Agenda as bordas a partir de agora; uma borda de descida "perdida" muda
+// o nível sem chamar a ISR
+void startDhtResponse(uint8_t pin) {
+  std::vector<uint32_t> wave;
+  if (!g_dhtWaves.empty()) {
+    wave = g_dhtWaves[g_dhtNextWave++ % g_dhtWaves.size()];
+  } else {
+    wave = dhtWaveform(g_dhtTemp, g_dhtHum);
+  }
+  std::uniform_int_distribution<int> jitter(-(int)g_dhtJitterUs, (int)g_dhtJitterUs);
+  std::uniform_real_distribution<double> pct(0.0, 100.0);
+  uint64_t at = g_nowUs;
+  for (size_t i = 0; i < wave.size(); i++) {
+    int d = (int)wave[i] + (g_dhtJitterUs ? jitter(g_dhtRng) : 0);
+    at += d > 1 ? d : 1;
+    int level = i % 2 == 0 ? LOW : HIGH;
+    bool miss = level == LOW && g_dhtMissPct > 0 && pct(g_dhtRng) < g_dhtMissPct;
+    scheduleEvent(SimEvent{at, [pin, level, miss] {
+      if (miss) g_pins[pin].level = level;
+      else sim::setPin(pin, level);
+    }});
+  }
+}
+} // namespace
+
+// --- WiFi ---
+SimWiFi WiFi;
+
+void SimWiFi::begin(const char*, const char*) { g_wifiBegun = true; }
+int SimWiFi::status() { return (g_wifiBegun && g_wifiAvailable) ? WL_CONNECTED : WL_DISCONNECTED; }
+
+void WiFiClientSecure::stop() { linkDown(); }
+
+// --- MQTT ---
+bool PubSubClient::connect(const char*, const char*, const char*) {
+  spendUs(g_mqttConnectCostUs);
+  g_mqttConnected = g_mqttAvailable && WiFi.status() == WL_CONNECTED;
+  return g_mqttConnected;
+}
+
+bool PubSubClient::connected() {
+  if (g_mqttConnected && (!g_mqttAvailable || WiFi.status() != WL_CONNECTED)) linkDown();
+  return g_mqttConnected;
+}
+
+void PubSubClient::disconnect() { linkDown(); }
+
+bool PubSubClient::loop() {
+  if (!connected()) return false;
+  while (!g_toClient.empty() && g_toClient.front().atUs <= g_nowUs) {
+    sim::Message msg = g_toClient.front();
+    g_toClient.pop_front();
+    bool subscribed = std::find(g_subscriptions.begin(), g_subscriptions.end(), msg.topic) !=
+                      g_subscriptions.end();
+    if (!subscribed || !callback_) continue;
+    std::string topic = msg.topic;
+    callback_(&topic[0], msg.payload.data(), (unsigned int)msg.payload.size());
+  }
+  return true;
+}
+
+bool PubSubClient::subscribe(const char* topic) {
+  if (!connected()) return false;
+  g_subscriptions.push_back(topic);
+  return true;
+}
+int PubSubClient::state() { return connected() ? 0 : -1; }
+
+bool PubSubClient::publish(const char* topic, const char* payload) {
+  return publish(topic, (const uint8_t*)payload, (unsigned int)strlen(payload), false);
+}
+
+bool PubSubClient::publish(const char* topic, const uint8_t* payload, unsigned int len, bool) {
+  // Mesmo limite do PubSubClient real: cabeçalho + tópico + payload no buffer
+  if (!connected() || 5 + 2 + strlen(topic) + len > bufferSize_) return false;
+  spendUs(g_mqttPublishCostUs);
+  sendToBroker(topic, payload, len);
+  return true;
+}
+
+bool PubSubClient::beginPublish(const char* topic, unsigned int len, bool) {
+  if (!connected()) return false;
+  pendingTopic_ = topic;
+  pending_.clear();
+  pendingLen_ = len;
+  publishing_ = true;
+  return true;
+}
+
+size_t PubSubClient::write(uint8_t c) { return write(&c, 1); }
+
+size_t PubSubClient::write(const uint8_t* buf, size_t len) {
+  if (!publishing_ || !connected()) return 0;
+  pending_.insert(pending_.end(), buf, buf + len);
+  return len;
+}
+
+int PubSubClient::endPublish() {
+  if (!publishing_) return 0;
+  publishing_ = false;
+  if (!connected() || pending_.size() != pendingLen_) return 0;
+  spendUs(g_mqttPublishCostUs);
+  sendToBroker(pendingTopic_, pending_.data(), pending_.size());
+  return 1;
+}
+
+// --- Tasks ---
+bool halStartTask(void (*fn)(void*), const char*, uint32_t, int, int) {
+  std::unique_lock<std::mutex> lock(g_taskMutex);
+  SimTask* task = new SimTask;
+  g_tasks.push_back(task);
+  g_tasksRunning++;
+  std::thread([fn, task] {
+    t_task = task;
+    fn(nullptr);
+    std::lock_guard<std::mutex> done(g_taskMutex);
+    g_tasks.erase(std::find(g_tasks.begin(), g_tasks.end(), task));
+    delete task;
+    g_tasksRunning--;
+    g_taskCv.notify_all();
+  }).detach();
+  // Roda até o primeiro custo simulado (ou até o fim) antes de devolver
+  waitTasksIdle(lock);
+  return true;
+}
+
+uint32_t halRandom() {
+  if (const char* id = getenv("CARDIOIA_SIM_BOOT_ID")) return (uint32_t)strtoul(id, nullptr, 10);
+  static std::random_device rd;
+  return rd();
+}
+
+uint32_t halCycleCount() { return (uint32_t)(g_nowUs * halCpuMhz()); }
+
+// --- Armazenamento ---
+bool halFsBegin() { return true; }
+
+// CARDIOIA_SIM_FS faz o papel da flash entre execuções (reboot). Sem ele,
+// cada execução usa um diretório temporário novo e começa com a flash vazia.
+static const char* simFsDir() {
+  if (const char* dir = getenv("CARDIOIA_SIM_FS")) return dir;
+  static std::string tmp;
+  if (tmp.empty()) {
+    const char* base = getenv("TMPDIR");
+    std::string templ = std::string(base && *base ? base : "/tmp") + "/cardioia_fs_XXXXXX";
+    std::vector<char> buf(templ.begin(), templ.end());
+    buf.push_back('\0');
+    tmp = mkdtemp(buf.data()) ? buf.data() : ".";
+  }
+  return tmp.c_str();
+}
+
+LogStorage& halLogStorage() {
+  static PosixLogStorage storage(simFsDir());
+  return storage;
+}
+
+// --- Controle da simulação ---
+namespace sim {
+
+uint64_t nowUs() { return g_nowUs; }
+void setNowUs(uint64_t us) { g_nowUs = us; }
+
+void advanceUs(uint64_t us) {
+  uint64_t target = g_nowUs + us;
+  fireEventsUntil(target);
+  g_nowUs = target;
+  wakeTasksUntil(target);
+  brokerReceiveUntil(target);
+}
+
+void setPin(uint8_t pin, int level) {
+  PinState& p = g_pins[pin];
+  if (p.level == level) return;
+  p.level = level;
+  bool fire = p.isr && (p.mode == CHANGE ||
+                        (p.mode == RISING && level == HIGH) ||
+                        (p.mode == FALLING && level == LOW));
+  if (fire) p.isr();
+}
+
+void schedulePulse(uint8_t pin, uint64_t atUs, uint32_t widthMs) {
+  scheduleEvent(SimEvent{atUs, [pin] { setPin(pin, HIGH); }});
+  scheduleEvent(SimEvent{atUs + (uint64_t)widthMs * 1000, [pin] { setPin(pin, LOW); }});
+}
+
+void scheduleAt(uint64_t atUs, std::function<void()> action) {
+  scheduleEvent(SimEvent{atUs, std::move(action)});
+}
+
+void setDht(float temperature, float humidity) { g_dhtTemp = temperature; g_dhtHum = humidity; }
+void setDhtReadCostUs(uint32_t us) { g_dhtCostUs = us; }
+void attachDht(uint8_t pin) {
+  g_pins[pin].dht = true;
+  g_pins[pin].level = HIGH;
+}
+void setDhtWaveforms(const std::vector<std::vector<uint32_t>>& waves) {
+  g_dhtWaves = waves;
+  g_dhtNextWave = 0;
+}
+void setDhtJitterUs(uint32_t us) { g_dhtJitterUs = us; }
+void setDhtMissPct(double pct) { g_dhtMissPct = pct; }
+void setWifiAvailable(bool up) { g_wifiAvailable = up; }
+void setMqttAvailable(bool up) { g_mqttAvailable = up; }
+void setMqttConnectCostUs(uint32_t us) { g_mqttConnectCostUs = us; }
+void setMqttPublishCostUs(uint32_t us) { g_mqttPublishCostUs = us; }
+void dropMqtt() { linkDown(); }
+void setLinkDelayUs(uint32_t us) { g_linkDelayUs = us; }
+void onBrokerReceive(void (*hook)(const Message& msg)) { g_brokerHook = hook; }
+void onPublish(void (*hook)(const char* topic)) { g_publishHook = hook; }
+
+void deliver(const char* topic, const char* payload) {
+  g_toClient.push_back(Message{topic, std::vector<uint8_t>(payload, payload + strlen(payload)),
+                               g_nowUs + g_linkDelayUs});
+}
+
+void serialInput(const char* line) {
+  while (*line) g_serialIn.push_back(*line++);
+  g_serialIn.push_back('\n');
+  if (g_serialReceive) g_serialReceive();
+}
+
+void setSerialEcho(bool echo) { g_serialEcho = echo; }
+
+const std::vector<Message>& published() { return g_published; }
+void clearPublished() { g_published.clear(); }
+
+} // namespace sim
+
+// --- Ambiente da simulação (batimentos, capturas do DHT, RAM retida) ---
+namespace {
+uint64_t g_beatPeriodUs = 800000;   // 75 bpm
+
+void beatAt(uint8_t pin, uint64_t atUs, uint64_t untilUs) {
+  if (atUs >= untilUs) return;
+  sim::schedulePulse(pin, atUs, 50);
+  sim::scheduleAt(atUs, [pin, atUs, untilUs] { beatAt(pin, atUs + g_beatPeriodUs, untilUs); });
+}
+} // namespace
+
+// Seção HAL_NOINIT (o linker define início e fim)
+extern "C" uint8_t __start_cardioia_noinit[] __attribute__((weak));
+extern "C" uint8_t __stop_cardioia_noinit[] __attribute__((weak));
+
+namespace sim {
+
+void startBeats(uint8_t pin, uint64_t atUs, uint64_t untilUs) { beatAt(pin, atUs, untilUs); }
+void setBeatPeriodUs(uint64_t us) { g_beatPeriodUs = us; }
+
+bool loadDhtWaveforms(const char* path) {
+  FILE* f = fopen(path, "r");
+  if (!f) return false;
+  std::vector<std::vector<uint32_t>> waves;
+  char line[4096];
+  while (fgets(line, sizeof(line), f)) {
+    std::vector<uint32_t> wave;
+    for (char* p = line; *p && *p != '#';) {
+      if (!isdigit((unsigned char)*p)) { p++; continue; }
+      wave.push_back((uint32_t)strtoul(p, &p, 10));
+    }
+    if (!wave.empty()) waves.push_back(wave);
+  }
+  fclose(f);
+  setDhtWaveforms(waves);
+  return true;
+}
+
+size_t noinitSize() { return (size_t)(__stop_cardioia_noinit - __start_cardioia_noinit); }
+
+size_t loadNoinit(const char* path) {
+  FILE* f = fopen(path, "rb");
+  if (!f) return 0;
+  size_t n = fread(__start_cardioia_noinit, 1, noinitSize(), f);
+  fclose(f);
+  return n;
+}
+
+bool saveNoinit(const char* path) {
+  FILE* f = fopen(path, "wb");
+  if (!f) return false;
+  bool ok = fwrite(__start_cardioia_noinit, 1, noinitSize(), f) == noinitSize();
+  fclose(f);
+  return ok;
+}
+
+void flipNoinitByte(size_t offset) {
+  if (offset < noinitSize()) __start_cardioia_noinit[offset] ^= 0xFF;
+}
+
+} // namespace sim
+
+#endif
@@ -0,0 +1,277 @@
+#pragma once
+// HAL simulada para o ambiente native (Linux). Implementa só o subconjunto da
+// API Arduino/DHTesp/WiFi/PubSubClient usado pelo firmware. O tempo não
+// corre sozinho: avança por sim::advanceUs()/advanceMs() ou delay().
+#ifndef ARDUINO
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "crc.h"
+#include "log_storage.h"
+
+#define IRAM_ATTR
+#define F(s) (s)
+#define HIGH 1
+#define LOW 0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+
+// --- Tempo (relógio virtual) ---
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+
+// --- GPIO ---
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t level);
+inline int digitalPinToInterrupt(int pin) { return pin; }
+void attachInterrupt(uint8_t pin, void (*isr)(), int mode);
+void detachInterrupt(uint8_t pin);
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+// --- String (subconjunto) ---
+class String {
+public:
+  String() {}
+  String(const char* s) : s_(s ? s : "") {}
+  size_t length() const { return s_.size(); }
+  const char* c_str() const { return s_.c_str(); }
+private:
+  std::string s_;
+};
+
+// --- Serial (stdout + entrada injetada pela simulação) ---
+class SimSerial {
+public:
+  void begin(unsigned long) {}
+  int available();
+  int read();
+  size_t write(uint8_t c);
+  size_t write(const uint8_t* buf, size_t len);
+  int availableForWrite() { return 128; }
+  void flush() {}
+
+  size_t print(const char* s);
+  size_t print(const String& s) { return print(s.c_str()); }
+  size_t print(char c);
+  size_t print(int v) { return print((long)v); }
+  size_t print(unsigned int v) { return print((unsigned long)v); }
+  size_t print(long v);
+  size_t print(unsigned long v);
+  size_t print(double v, int digits = 2);
+  size_t println() { return print("\r\n"); }
+  template <typename T> size_t println(T v) { size_t n = print(v); return n + println(); }
+  size_t println(double v, int digits) { size_t n = print(v, digits); return n + println(); }
+};
+extern SimSerial Serial;
+
+struct SimEsp {
+  uint64_t getEfuseMac() { return 0x0000A1B2C3D4E5F6ULL; }
+  uint32_t getFreeHeap() { return 200000; }
+};
+extern SimEsp ESP;
+
+// --- DHT22 ---
+struct TempAndHumidity {
+  float temperature;
+  float humidity;
+};
+
+class DHTesp {
+public:
+  enum DHT_MODEL_t { AUTO_DETECT, DHT11, DHT22, AM2302, RHT03 };
+  void setup(uint8_t pin, DHT_MODEL_t model) { pin_ = pin; (void)model; }
+  TempAndHumidity getTempAndHumidity();
+private:
+  uint8_t pin_ = 0;
+};
+
+// --- WiFi ---
+#define WL_IDLE_STATUS 0
+#define WL_CONNECTED 3
+#define WL_DISCONNECTED 6
+#define WIFI_STA 1
+
+class SimWiFi {
+public:
+  void mode(int) {}
+  void begin(const char* ssid, const char* pass);
+  int status();
+};
+extern SimWiFi WiFi;
+
+class WiFiClientSecure {
+public:
+  void setInsecure() {}
+  void setHandshakeTimeout(unsigned long) {}
+  void stop();
+};
+
+// --- MQTT (PubSubClient) ---
+class PubSubClient {
+public:
+  typedef void (*Callback)(char* topic, uint8_t* payload, unsigned int len);
+  explicit PubSubClient(WiFiClientSecure&) {}
+  PubSubClient& setServer(const char*, uint16_t) { return *this; }
+  PubSubClient& setSocketTimeout(uint16_t) { return *this; }
+  PubSubClient& setCallback(Callback cb) { callback_ = cb; return *this; }
+  bool setBufferSize(uint16_t size) { bufferSize_ = size; return true; }
+  bool connect(const char* id, const char* user, const char* pass);
+  bool connected();
+  void disconnect();
+  bool loop();
+  bool subscribe(const char* topic);
+  int state();
+  bool publish(const char* topic, const char* payload);
+  bool publish(const char* topic, const uint8_t* payload, unsigned int len, bool retained = false);
+  bool beginPublish(const char* topic, unsigned int len, bool retained);
+  size_t write(uint8_t c);
+  size_t write(const uint8_t* buf, size_t len);
+  int endPublish();
+private:
+  Callback callback_ = nullptr;
+  uint16_t bufferSize_ = 256;
+  std::string pendingTopic_;
+  std::vector<uint8_t> pending_;
+  size_t pendingLen_ = 0;
+  bool publishing_ = false;
+};
+
+// --- Tasks (std::thread no host) ---
+// Custos simulados gastos fora da thread principal não avançam o relógio:
+// a task espera o loop principal levar o relógio virtual até o fim do custo.
+bool halStartTask(void (*fn)(void*), const char* name, uint32_t stackBytes,
+                  int priority, int core);
+inline void halEndTask() {}
+
+// Memória .noinit: no host, uma seção própria que a simulação carrega de
+// CARDIOIA_SIM_NOINIT antes do setup() e grava no fim da execução, como se
+// o ESP32 resetasse ali
+#define HAL_NOINIT __attribute__((section("cardioia_noinit")))
+
+inline uint32_t halCrc32(const void* data, size_t len) { return crc32(data, len); }
+
+// Aleatório do "hardware": CARDIOIA_SIM_BOOT_ID fixa o valor (reprodutível)
+uint32_t halRandom();
+
+// Ciclos derivados do relógio virtual, como numa CPU de 240 MHz: só os
+// custos simulados aparecem no profiling
+uint32_t halCycleCount();
+inline uint32_t halCpuMhz() { return 240; }
+
+// Seção crítica curta entre tasks (portMUX no ESP32)
+class HalLock {
+public:
+  void lock() { m_.lock(); }
+  void unlock() { m_.unlock(); }
+private:
+  std::mutex m_;
+};
+
+// Evento para acordar o loop: wait() avança o relógio virtual até um signal()
+// (ISR, serial, task) ou o timeout, parando em cada evento agendado da
+// simulação. Um signal() antes do wait() não se perde.
+class HalEvent {
+public:
+  void wait(uint32_t timeoutMs);
+  void signal() { signaled_.store(true); }
+  void signalFromIsr() { signal(); }
+private:
+  std::atomic<bool> signaled_{false};
+};
+
+// Chamado quando chegam bytes no Serial (sim::serialInput)
+void halOnSerialReceive(void (*fn)());
+
+// --- Armazenamento do log persistente (diretório no host) ---
+bool halFsBegin();
+LogStorage& halLogStorage();
+
+// --- Controle da simulação ---
+namespace sim {
+
+struct Message {
+  std::string topic;
+  std::vector<uint8_t> payload;
+  uint64_t atUs;
+};
+
+// Relógio: avança e dispara eventos agendados (pulsos, bordas de GPIO)
+uint64_t nowUs();
+void setNowUs(uint64_t us);   // ex.: perto do overflow de millis()
+void advanceUs(uint64_t us);
+inline void advanceMs(uint32_t ms) { advanceUs((uint64_t)ms * 1000); }
+
+// GPIO: muda o nível de um pino de entrada (chama a ISR anexada)
+void setPin(uint8_t pin, int level);
+// Agenda um pulso HIGH de widthMs no pino em atUs
+void schedulePulse(uint8_t pin, uint64_t atUs, uint32_t widthMs);
+// Agenda uma ação qualquer (comando serial, queda de link) em atUs
+void scheduleAt(uint64_t atUs, std::function<void()> action);
+
+// Sensores e rede
+void setDht(float temperature, float humidity);
+void setDhtReadCostUs(uint32_t us);      // tempo gasto (bloqueante) por leitura
+// DHT22 ligado ao pino (linha com pull-up): quando o firmware puxa a linha
+// para LOW e a solta, o sensor responde com a forma de onda do protocolo
+// (valores de setDht(), ou as gravadas). Só para a leitura assíncrona; o
+// DHTesp simulado continua devolvendo setDht() direto.
+void attachDht(uint8_t pin);
+// Formas de onda gravadas, usadas em ciclo, uma por leitura: durações em µs
+// alternando os níveis, a partir do HIGH entre a liberação e a resposta
+void setDhtWaveforms(const std::vector<std::vector<uint32_t>>& waves);
+void setDhtJitterUs(uint32_t us);        // ±us aleatório em cada nível
+void setDhtMissPct(double pct);          // chance de a ISR perder uma borda
+void setWifiAvailable(bool up);
+void setMqttAvailable(bool up);
+void setMqttConnectCostUs(uint32_t us);  // tempo gasto (bloqueante) por connect()
+void setMqttPublishCostUs(uint32_t us);  // tempo por PUBLISH enviado
+void dropMqtt();                         // derruba a conexão atual
+// Atraso de ida do link: um PUBLISH chega ao broker (e uma mensagem do broker
+// ao cliente) depois dele. Ao cair a conexão, o que está no fio se perde.
+void setLinkDelayUs(uint32_t us);
+void onBrokerReceive(void (*hook)(const Message& msg));
+// Chamado dentro de publish()/endPublish(), com o PUBLISH ainda em curso
+// (no ESP32, o write TLS bloqueante): ponto para simular um reset no envio
+void onPublish(void (*hook)(const char* topic));
+// Mensagem do broker para o cliente (entregue no mqtt.loop() se assinada)
+void deliver(const char* topic, const char* payload);
+
+// Serial: injeta uma linha como se digitada no monitor
+void serialInput(const char* line);
+void setSerialEcho(bool echo);           // imprime a saída do Serial no stdout
+
+const std::vector<Message>& published();
+void clearPublished();
+
+// Ambiente: batimentos (pulsos no pino do botão, no ritmo vigente) de atUs
+// até untilUs; capturas do DHT22 num arquivo, uma leitura por linha com as
+// durações em µs separadas por espaço ou vírgula ('#' comenta); e a seção
+// HAL_NOINIT, que um arquivo carrega antes do setup() e recebe no fim,
+// fazendo o papel da RAM entre resets (arquivo curto deixa o resto zerado).
+void startBeats(uint8_t pin, uint64_t atUs, uint64_t untilUs);
+void setBeatPeriodUs(uint64_t us);
+bool loadDhtWaveforms(const char* path);
+size_t noinitSize();
+size_t loadNoinit(const char* path);     // bytes lidos (0 sem arquivo)
+bool saveNoinit(const char* path);
+void flipNoinitByte(size_t offset);      // corrompe um byte da RAM retida
+
+} // namespace sim
+
+#endif // !ARDUINO
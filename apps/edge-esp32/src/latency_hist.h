@@ -0,0 +1,51 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// --- Histograma de latência (buckets log2) ---
+// add() em O(1), sem alocação: o bucket b guarda valores com b bits
+// significativos (0, 1, 2-3, 4-7, ...). Os percentis saem com resolução de
+// 2x (limite superior do bucket, limitado pelo máximo observado), o
+// suficiente para p50/p99 de tempos de loop em µs.
+class LatencyHist {
+public:
+  static const uint8_t BUCKETS = 33;
+
+  void add(uint32_t v) {
+    buckets_[bucketOf(v)]++;
+    count_++;
+    if (v > max_) max_ = v;
+  }
+
+  // pct em 0..100; 0 com o histograma vazio
+  uint32_t percentile(uint8_t pct) const {
+    if (count_ == 0) return 0;
+    uint64_t target = ((uint64_t)count_ * pct + 99) / 100;
+    if (target == 0) target = 1;
+    uint64_t seen = 0;
+    for (uint8_t b = 0; b < BUCKETS; b++) {
+      seen += buckets_[b];
+      if (seen >= target) {
+        uint32_t upper = b == 0 ? 0 : b >= 32 ? UINT32_MAX : (1UL << b) - 1;
+        return upper < max_ ? upper : max_;
+      }
+    }
+    return max_;
+  }
+
+  uint32_t count() const { return count_; }
+  uint32_t max() const { return max_; }
+
+  void reset() {
+    for (uint8_t b = 0; b < BUCKETS; b++) buckets_[b] = 0;
+    count_ = 0;
+    max_ = 0;
+  }
+
+private:
+  static uint8_t bucketOf(uint32_t v) { return v ? 32 - __builtin_clz(v) : 0; }
+
+  uint32_t buckets_[BUCKETS] = {};
+  uint32_t count_ = 0;
+  uint32_t max_ = 0;
+};
@@ -0,0 +1,181 @@
+#include "log.h"
+#include "hal.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+static_assert((LOG_RING_SIZE & (LOG_RING_SIZE - 1)) == 0, "LOG_RING_SIZE deve ser potência de 2");
+
+volatile uint8_t logCurrentLevel = LOG_LEVEL_DEFAULT;
+
+// --- Registros no ring ---
+// Cabeçalho de 4 bytes + payload: texto da linha, LogDeferredRec, ou o
+// número de linhas perdidas (uint32_t) no ponto em que a perda aconteceu.
+enum : uint8_t { LOG_REC_TEXT, LOG_REC_DEFERRED, LOG_REC_DROPS };
+
+struct LogRecHeader {
+  uint8_t kind;
+  uint8_t level;
+  uint16_t len;
+};
+
+struct LogDeferredRec {
+  const char* fmt;
+  uint32_t args[4];
+};
+
+static uint8_t logRing[LOG_RING_SIZE];
+static uint32_t logHead = 0;   // posição de escrita (monotônica)
+static uint32_t logTail = 0;   // posição de leitura (monotônica)
+static uint32_t logDrops = 0;         // total de linhas perdidas
+static uint32_t logDropsMarked = 0;   // já registradas no ring
+static HalLock logLock;        // produtores em tasks diferentes + drain
+static HalEvent logEvent;      // acorda a task de log
+
+static void ringCopyIn(uint32_t pos, const void* src, size_t len) {
+  size_t at = pos & (LOG_RING_SIZE - 1);
+  size_t first = LOG_RING_SIZE - at < len ? LOG_RING_SIZE - at : len;
+  memcpy(logRing + at, src, first);
+  memcpy(logRing, (const uint8_t*)src + first, len - first);
+}
+
+static void ringCopyOut(uint32_t pos, void* dst, size_t len) {
+  size_t at = pos & (LOG_RING_SIZE - 1);
+  size_t first = LOG_RING_SIZE - at < len ? LOG_RING_SIZE - at : len;
+  memcpy(dst, logRing + at, first);
+  memcpy((uint8_t*)dst + first, logRing, len - first);
+}
+
+static void ringPut(uint8_t kind, uint8_t level, const void* payload, size_t len) {
+  LogRecHeader h{kind, level, (uint16_t)len};
+  ringCopyIn(logHead, &h, sizeof(h));
+  ringCopyIn(logHead + sizeof(h), payload, len);
+  logHead += sizeof(h) + len;
+}
+
+static void logPush(uint8_t kind, LogLevel level, const void* payload, size_t len) {
+  logLock.lock();
+  uint32_t lost = logDrops - logDropsMarked;
+  size_t need = sizeof(LogRecHeader) + len;
+  if (lost) need += sizeof(LogRecHeader) + sizeof(lost);
+  if (LOG_RING_SIZE - (logHead - logTail) < need) {
+    logDrops++;
+  } else {
+    // A perda sai na ordem em que aconteceu, antes da primeira linha que coube
+    if (lost) {
+      ringPut(LOG_REC_DROPS, LOG_ERROR, &lost, sizeof(lost));
+      logDropsMarked = logDrops;
+    }
+    ringPut(kind, level, payload, len);
+  }
+  logLock.unlock();
+  logEvent.signal();
+}
+
+void logWrite(LogLevel level, const char* text) {
+  if (!logEnabled(level)) return;
+  size_t len = strlen(text);
+  if (len > LOG_LINE_MAX) len = LOG_LINE_MAX;
+  logPush(LOG_REC_TEXT, level, text, len);
+}
+
+void logPrintf(LogLevel level, const char* fmt, ...) {
+  if (!logEnabled(level)) return;
+  char line[LOG_LINE_MAX + 1];
+  va_list ap;
+  va_start(ap, fmt);
+  int n = vsnprintf(line, sizeof(line), fmt, ap);
+  va_end(ap);
+  if (n < 0) return;
+  size_t len = (size_t)n < sizeof(line) ? (size_t)n : sizeof(line) - 1;
+  logPush(LOG_REC_TEXT, level, line, len);
+}
+
+void logDeferred(LogLevel level, const char* fmt, uint8_t nargs,
+                 uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3) {
+  (void)nargs;  // os argumentos não usados vão como 0 e o formato os ignora
+  if (!logEnabled(level)) return;
+  LogDeferredRec rec{fmt, {a0, a1, a2, a3}};
+  logPush(LOG_REC_DEFERRED, level, &rec, sizeof(rec));
+}
+
+// --- Nível ---
+static const char* const LOG_LEVEL_NAMES[LOG_LEVELS] = {"ERROR", "WARN", "INFO", "DEBUG"};
+
+void logSetLevel(LogLevel level) { logCurrentLevel = level; }
+const char* logLevelName(LogLevel level) { return level < LOG_LEVELS ? LOG_LEVEL_NAMES[level] : "?"; }
+
+bool logParseLevel(const char* name, LogLevel& level) {
+  for (uint8_t i = 0; i < LOG_LEVELS; i++) {
+    if (strcasecmp(name, LOG_LEVEL_NAMES[i]) == 0) {
+      level = (LogLevel)i;
+      return true;
+    }
+  }
+  return false;
+}
+
+uint32_t logDropped() { return logDrops; }
+
+// --- Drain ---
+// Uma linha formatada por vez; o que não coube no FIFO fica para a próxima
+static char logOut[LOG_LINE_MAX + 2];
+static size_t logOutLen = 0;
+static size_t logOutPos = 0;
+
+// Próxima linha do ring em logOut; false se vazio
+static bool logNextLine() {
+  LogRecHeader h;
+  union {
+    char text[LOG_LINE_MAX];
+    LogDeferredRec deferred;
+    uint32_t lost;
+  } payload;
+  logLock.lock();
+  bool empty = logHead == logTail;
+  if (!empty) {
+    ringCopyOut(logTail, &h, sizeof(h));
+    ringCopyOut(logTail + sizeof(h), &payload, h.len);
+    logTail += sizeof(h) + h.len;
+  }
+  logLock.unlock();
+  if (empty) return false;
+  int n;
+  if (h.kind == LOG_REC_DEFERRED) {
+    const LogDeferredRec& d = payload.deferred;
+    n = snprintf(logOut, LOG_LINE_MAX + 1, d.fmt, (unsigned long)d.args[0],
+                 (unsigned long)d.args[1], (unsigned long)d.args[2], (unsigned long)d.args[3]);
+  } else if (h.kind == LOG_REC_DROPS) {
+    n = snprintf(logOut, LOG_LINE_MAX + 1, "[LOG] perdidas=%lu", (unsigned long)payload.lost);
+  } else {
+    memcpy(logOut, payload.text, h.len);
+    n = h.len;
+  }
+  logOutLen = n < 0 ? 0 : (size_t)n > LOG_LINE_MAX ? LOG_LINE_MAX : n;
+  logOut[logOutLen++] = '\r';
+  logOut[logOutLen++] = '\n';
+  logOutPos = 0;
+  return true;
+}
+
+bool logPending() {
+  return logOutPos != logOutLen || logHead != logTail;
+}
+
+void logWait(uint32_t timeoutMs) { logEvent.wait(timeoutMs); }
+
+size_t logDrain() {
+  size_t written = 0;
+  for (;;) {
+    if (logOutPos == logOutLen && !logNextLine()) break;
+    int room = Serial.availableForWrite();
+    if (room <= 0) break;
+    size_t n = logOutLen - logOutPos;
+    if (n > (size_t)room) n = room;
+    Serial.write((const uint8_t*)logOut + logOutPos, n);
+    logOutPos += n;
+    written += n;
+  }
+  return written;
+}
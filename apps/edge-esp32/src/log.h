@@ -0,0 +1,60 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// --- Log assíncrono ---
+// As chamadas de log só copiam a linha para um ring fixo em RAM (poucos µs);
+// quem escreve no UART é logDrain(), chamado pela task de log (dual-core) ou
+// pelo loop(), e ele só escreve o que cabe no FIFO de TX sem esperar
+// (Serial.availableForWrite()). Com o ring cheio a linha é descartada e a
+// perda aparece depois como "[LOG] perdidas=<n>".
+//
+// Níveis filtram antes de formatar; o nível corrente muda em runtime
+// (comando LOG). LOG_DEFER guarda só o ponteiro do formato e até 4 inteiros
+// de 32 bits: a formatação fica para o drain (modo compacto para logs de
+// alta frequência). O formato precisa ser literal e usar %lu/%ld/%lx.
+#ifndef LOG_RING_SIZE
+#define LOG_RING_SIZE 4096
+#endif
+#ifndef LOG_LINE_MAX
+#define LOG_LINE_MAX 192
+#endif
+// Com linhas pendentes, o drain volta depois deste intervalo (o FIFO de TX
+// de 128 bytes leva ~11 ms para esvaziar a 115200 baud)
+#ifndef LOG_DRAIN_POLL_MS
+#define LOG_DRAIN_POLL_MS 5
+#endif
+#ifndef LOG_LEVEL_DEFAULT
+#define LOG_LEVEL_DEFAULT LOG_INFO
+#endif
+
+enum LogLevel : uint8_t { LOG_ERROR, LOG_WARN, LOG_INFO, LOG_DEBUG, LOG_LEVELS };
+
+extern volatile uint8_t logCurrentLevel;
+
+inline bool logEnabled(LogLevel level) { return level <= logCurrentLevel; }
+void logSetLevel(LogLevel level);
+const char* logLevelName(LogLevel level);
+// Nome (sem diferenciar maiúsculas) -> nível; false se desconhecido
+bool logParseLevel(const char* name, LogLevel& level);
+
+// Uma linha (sem "\r\n": o drain acrescenta)
+void logWrite(LogLevel level, const char* text);
+void logPrintf(LogLevel level, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+void logDeferred(LogLevel level, const char* fmt, uint8_t nargs,
+                 uint32_t a0 = 0, uint32_t a1 = 0, uint32_t a2 = 0, uint32_t a3 = 0);
+
+#define LOG_ARGC_(_0, _1, _2, _3, _4, N, ...) N
+#define LOG_DEFER(level, fmt, ...) \
+  do { \
+    if (logEnabled(level)) \
+      logDeferred(level, fmt, LOG_ARGC_(0, ##__VA_ARGS__, 4, 3, 2, 1, 0), ##__VA_ARGS__); \
+  } while (0)
+
+// Escreve no UART o que couber agora; devolve os bytes escritos
+size_t logDrain();
+// Ainda há algo para escrever (ring ou linha pela metade)
+bool logPending();
+// Dorme até uma linha nova ou o timeout (task de log)
+void logWait(uint32_t timeoutMs);
+uint32_t logDropped();
@@ -0,0 +1,160 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// --- Armazenamento de arquivos do log persistente ---
+// Interface mínima usada pelo FlashLog. No ESP32 usa LittleFS; no host
+// (Linux) usa arquivos comuns, para medir amplificação de escrita e tempo
+// de recuperação fora do dispositivo.
+class LogStorage {
+public:
+  virtual ~LogStorage() {}
+  virtual bool begin() = 0;
+  // Acrescenta ao fim do arquivo (cria se não existir)
+  virtual bool append(const char* name, const void* data, size_t len) = 0;
+  // Lê até len bytes a partir de off; retorna bytes lidos
+  virtual size_t read(const char* name, size_t off, void* data, size_t len) = 0;
+  // Tamanho em bytes, ou -1 se não existir
+  virtual long size(const char* name) = 0;
+  virtual bool remove(const char* name) = 0;
+  // Substitui o arquivo inteiro de forma atômica (tmp + rename)
+  virtual bool replace(const char* name, const void* data, size_t len) = 0;
+
+  // Contadores de E/S (bytes efetivamente gravados/lidos)
+  uint32_t bytesWritten = 0;
+  uint32_t bytesRead = 0;
+
+protected:
+  void path(char* out, size_t cap, const char* root, const char* name) {
+    snprintf(out, cap, "%s/%s", root, name);
+  }
+};
+
+#ifdef ARDUINO
+#include <FS.h>
+
+class FsLogStorage : public LogStorage {
+public:
+  FsLogStorage(fs::FS& fs, const char* root) : fs_(fs), root_(root) {}
+
+  bool begin() override {
+    if (!fs_.exists(root_)) return fs_.mkdir(root_);
+    return true;
+  }
+
+  bool append(const char* name, const void* data, size_t len) override {
+    char p[48]; path(p, sizeof(p), root_, name);
+    fs::File f = fs_.open(p, FILE_APPEND);
+    if (!f) return false;
+    size_t n = f.write((const uint8_t*)data, len);
+    f.close();
+    bytesWritten += n;
+    return n == len;
+  }
+
+  size_t read(const char* name, size_t off, void* data, size_t len) override {
+    char p[48]; path(p, sizeof(p), root_, name);
+    fs::File f = fs_.open(p, FILE_READ);
+    if (!f) return 0;
+    size_t n = f.seek(off) ? f.read((uint8_t*)data, len) : 0;
+    f.close();
+    bytesRead += n;
+    return n;
+  }
+
+  long size(const char* name) override {
+    char p[48]; path(p, sizeof(p), root_, name);
+    if (!fs_.exists(p)) return -1;
+    fs::File f = fs_.open(p, FILE_READ);
+    if (!f) return -1;
+    long s = (long)f.size();
+    f.close();
+    return s;
+  }
+
+  bool remove(const char* name) override {
+    char p[48]; path(p, sizeof(p), root_, name);
+    return fs_.remove(p);
+  }
+
+  bool replace(const char* name, const void* data, size_t len) override {
+    char p[48], tmp[52];
+    path(p, sizeof(p), root_, name);
+    snprintf(tmp, sizeof(tmp), "%s.tmp", p);
+    fs::File f = fs_.open(tmp, FILE_WRITE);
+    if (!f) return false;
+    size_t n = f.write((const uint8_t*)data, len);
+    f.close();
+    bytesWritten += n;
+    if (n != len) return false;
+    return fs_.rename(tmp, p);
+  }
+
+private:
+  fs::FS& fs_;
+  const char* root_;
+};
+
+#else
+#include <sys/stat.h>
+
+class PosixLogStorage : public LogStorage {
+public:
+  explicit PosixLogStorage(const char* root) : root_(root) {}
+
+  bool begin() override {
+    struct stat st;
+    if (stat(root_, &st) == 0) return S_ISDIR(st.st_mode);
+    return mkdir(root_, 0755) == 0;
+  }
+
+  bool append(const char* name, const void* data, size_t len) override {
+    char p[256]; path(p, sizeof(p), root_, name);
+    FILE* f = fopen(p, "ab");
+    if (!f) return false;
+    size_t n = fwrite(data, 1, len, f);
+    fclose(f);
+    bytesWritten += n;
+    return n == len;
+  }
+
+  size_t read(const char* name, size_t off, void* data, size_t len) override {
+    char p[256]; path(p, sizeof(p), root_, name);
+    FILE* f = fopen(p, "rb");
+    if (!f) return 0;
+    size_t n = fseek(f, (long)off, SEEK_SET) == 0 ? fread(data, 1, len, f) : 0;
+    fclose(f);
+    bytesRead += n;
+    return n;
+  }
+
+  long size(const char* name) override {
+    char p[256]; path(p, sizeof(p), root_, name);
+    struct stat st;
+    if (stat(p, &st) != 0) return -1;
+    return (long)st.st_size;
+  }
+
+  bool remove(const char* name) override {
+    char p[256]; path(p, sizeof(p), root_, name);
+    return ::remove(p) == 0;
+  }
+
+  bool replace(const char* name, const void* data, size_t len) override {
+    char p[256], tmp[260];
+    path(p, sizeof(p), root_, name);
+    snprintf(tmp, sizeof(tmp), "%s.tmp", p);
+    FILE* f = fopen(tmp, "wb");
+    if (!f) return false;
+    size_t n = fwrite(data, 1, len, f);
+    fclose(f);
+    bytesWritten += n;
+    if (n != len) return false;
+    return ::rename(tmp, p) == 0;
+  }
+
+private:
+  const char* root_;
+};
+#endif
@@ -1,8 +1,25 @@
-#include <Arduino.h>
-#include <DHTesp.h>
-#include <WiFi.h>
-#include <WiFiClientSecure.h>
-#include <PubSubClient.h>
+#include "hal.h"
+#include <atomic>
+
+#include "sample.h"
+#include "sample_queue.h"
+#include "sample_agg.h"
+#include "sample_block.h"
+#include "sample_stats.h"
+#include "retained.h"
+#include "sample_json.h"
+#include "sample_wire.h"
+#include "flash_log.h"
+#include "spsc_queue.h"
+#include "beat_tracker.h"
+#include "alert_engine.h"
+#include "latency_hist.h"
+#include "delivery_window.h"
+#include "profile.h"
+#include "serial_cmd.h"
+#include "log.h"
+#include "scheduler.h"
+#include "dht_async.h"
 
 // Credenciais e host via macros em config.h (não versionado)
 // Crie src/config.h com seus dados a partir de config.h.example
@@ -19,6 +36,10 @@ static const int PIN_BTN = 4;      // Botão no GPIO 4 (pull-down externo)
 // --- Janelas e tempos ---
 static const uint32_t DHT_INTERVAL_MS = 2000;   // leitura a cada 2s
 static const uint32_t BPM_WINDOW_MS  = 10000;  // janela de 10s
+#ifndef BPM_SLIDING_WINDOW_MS
+#define BPM_SLIDING_WINDOW_MS 10000              // janela deslizante do estimador de BPM
+#endif
+static const uint32_t BEAT_REFRACTORY_MS = 200; // ignora bordas a menos de 200ms (> 300 bpm)
 
 // --- WiFi/MQTT (via config.h) ---
 #include "config.h"
@@ -41,125 +62,1196 @@ static const uint32_t BPM_WINDOW_MS  = 10000;  // janela de 10s
 #define MQTT_PASS ""
 #endif
 static const char* MQTT_TOPIC = "cardioia/ana/v1/vitals";
+static const char* MQTT_TOPIC_BIN = "cardioia/ana/v1/vitals/bin"; // formato binário compacto
+static const char* MQTT_TOPIC_BPM = "cardioia/ana/v1/vitals/bpm"; // BPM em streaming (por batimento)
+static const char* MQTT_TOPIC_ACK = "cardioia/ana/v1/vitals/ack"; // acks do consumidor (entrada)
+static const char* MQTT_TOPIC_ALERT = "cardioia/ana/v1/alert";     // transições de alerta (prioridade)
+
+// Período da telemetria de profiling em MQTT_TOPIC_PROF (0 = só pelo comando STATS)
+#ifndef PROFILE_TELEMETRY_MS
+#define PROFILE_TELEMETRY_MS 0
+#endif
+
+// --- Formato de publicação (WIRE_FORMAT em config.h) ---
+// WIRE_JSON: linha/array JSON em MQTT_TOPIC (padrão)
+// WIRE_BINARY: formato compacto (sample_wire.h) em MQTT_TOPIC_BIN
+// WIRE_BOTH: os dois; o JSON é o principal e define sucesso do envio
+#define WIRE_JSON   1
+#define WIRE_BINARY 2
+#define WIRE_BOTH   (WIRE_JSON | WIRE_BINARY)
+#ifndef WIRE_FORMAT
+#define WIRE_FORMAT WIRE_JSON
+#endif
+
+// --- Entrega confirmada (at-least-once) ---
+// O PubSubClient só publica em QoS 0 e descarta PUBACKs, então a confirmação
+// é de aplicação e ponta a ponta: o JSON sai como
+// {"boot":<id>,"seq":<n>,"base":<b>,"samples":[...]} (amostra i tem seq n+i;
+// b é o menor seq ainda sem ack) e o consumidor (Node-RED) responde em
+// MQTT_TOPIC_ACK com {"boot":<id>,"seq":<m>}, confirmando tudo até m. Um
+// consumidor sem estado do boot (reiniciado) só aceita a partir de b. Até DELIVERY_WINDOW mensagens ficam em voo ao mesmo
+// tempo; sem ack em DELIVERY_ACK_TIMEOUT_MS, ou numa conexão nova, são
+// reenviadas em ordem. O consumidor descarta duplicadas pelo seq.
+// DELIVERY_ACK 0 volta ao QoS 0 sem confirmação.
+#ifndef DELIVERY_ACK
+#define DELIVERY_ACK 1
+#endif
+#ifndef DELIVERY_WINDOW
+#define DELIVERY_WINDOW 4
+#endif
+#ifndef DELIVERY_ACK_TIMEOUT_MS
+#define DELIVERY_ACK_TIMEOUT_MS 5000
+#endif
+#if DELIVERY_ACK && !(WIRE_FORMAT & WIRE_JSON)
+#error "DELIVERY_ACK requer WIRE_JSON (o seq vai no envelope JSON)"
+#endif
+
+// --- Leitura do DHT22 ---
+// DHT_ASYNC 1: captura das bordas por ISR e decodificação fora dela
+// (dht_async.h), sem mascarar interrupções; o resultado de cada leitura
+// entra na contagem do relatório [DHT]. DHT_ASYNC 0 volta à leitura
+// bloqueante do DHTesp (~5 ms com interrupções mascaradas).
+#ifndef DHT_ASYNC
+#define DHT_ASYNC 1
+#endif
 
 // --- Estado global ---
+#if !DHT_ASYNC
 DHTesp dht;
-volatile uint32_t pulseCount = 0;  // contador de pulsos (batimentos)
+#endif
 volatile int lastBtnState = 0;     // para filtrar bouncing rápido dentro da ISR
 
-bool CONNECTED = false;            // estado de conectividade
+// Batimentos: a ISR grava o micros() de cada borda de subida numa fila SPSC
+// (ISR produz, sensoriamento consome); o BPM sai dos intervalos entre eles.
+SpscQueue<uint32_t, 64> beatQueue;
+volatile uint32_t beatQueueDrops = 0;
+BeatTracker<64> beats((uint32_t)BPM_SLIDING_WINDOW_MS * 1000, BEAT_REFRACTORY_MS * 1000);
+
+// --- BPM em streaming (opcional) ---
+// Além da amostra por janela, publica uma estimativa rápida (EWMA dos IBIs)
+// a cada batimento em MQTT_TOPIC_BPM. Batimentos próximos são agrupados:
+// no máximo uma mensagem por BPM_STREAM_MIN_INTERVAL_MS, sempre com a
+// estimativa mais recente. Só sai com a rede conectada (sem backlog).
+#ifndef BPM_STREAM_ENABLED
+#define BPM_STREAM_ENABLED 0
+#endif
+#ifndef BPM_STREAM_MIN_INTERVAL_MS
+#define BPM_STREAM_MIN_INTERVAL_MS 1000
+#endif
+static const uint8_t BPM_STREAM_EWMA_SHIFT = 1;  // peso 1/2 para o IBI novo
+
+struct BpmUpdate {
+  uint32_t ts;       // millis() da emissão
+  uint32_t beatUs;   // batimento mais antigo ainda não reportado (latência)
+  uint16_t bpmX10;   // BPM * 10
+  uint16_t ibiMs;    // IBI médio
+};
+SpscQueue<BpmUpdate, 16> bpmUpdateQueue;
+IbiEwma bpmFast(BPM_STREAM_EWMA_SHIFT);
+bool streamPending = false;
+uint32_t streamPendingBeatUs = 0;
+uint32_t streamLastEmitMs = 0;
 
-// Controle de tempo
-uint32_t lastDhtRead = 0;
-uint32_t windowStart = 0;
+// Latência batimento -> publicação, por modo
+struct LatencyStat {
+  uint32_t count = 0;
+  uint32_t sumMs = 0;
+  uint32_t maxMs = 0;
+  void add(uint32_t ms) { count++; sumMs += ms; if (ms > maxMs) maxMs = ms; }
+};
+LatencyStat latencyWindow;   // batimento mais antigo da janela -> fechamento
+LatencyStat latencyStream;   // batimento mais antigo agrupado -> publish
+bool windowHasBeat = false;
+uint32_t windowFirstBeatUs = 0;
+
+// --- Alertas na borda (alert_engine.h) ---
+// As regras do fn_norm avaliadas a cada leitura do DHT e a cada batimento,
+// com histerese. Cada transição vai por uma fila própria para a rede e sai
+// em MQTT_TOPIC_ALERT antes das amostras ao vivo e do backlog, num payload
+// mínimo. Sem MQTT as transições esperam na fila (até ALERT_QUEUE_MAX). O
+// BPM do alerta é uma EWMA dos IBIs (peso 1/2^ALERT_BPM_EWMA_SHIFT) que só
+// vale depois de ALERT_BPM_MIN_IBIS intervalos seguidos. Limiares mudam em
+// runtime pelo comando ALERT.
+#ifndef ALERT_ENGINE
+#define ALERT_ENGINE 1
+#endif
+#ifndef ALERT_TEMP_FIRE
+#define ALERT_TEMP_FIRE SAMPLE_ALERT_TEMP     // °C * 100, dispara acima
+#endif
+#ifndef ALERT_TEMP_CLEAR
+#define ALERT_TEMP_CLEAR 3780                 // °C * 100, normaliza em ou abaixo
+#endif
+#ifndef ALERT_BPM_FIRE
+#define ALERT_BPM_FIRE (SAMPLE_ALERT_BPM * 10)   // bpm * 10
+#endif
+#ifndef ALERT_BPM_CLEAR
+#define ALERT_BPM_CLEAR 1150
+#endif
+#ifndef ALERT_BPM_EWMA_SHIFT
+#define ALERT_BPM_EWMA_SHIFT 2
+#endif
+#ifndef ALERT_BPM_MIN_IBIS
+#define ALERT_BPM_MIN_IBIS 3
+#endif
+static const size_t ALERT_QUEUE_MAX = 8;
+
+AlertEngine alertEngine(ALERT_TEMP_FIRE, ALERT_TEMP_CLEAR, ALERT_BPM_FIRE, ALERT_BPM_CLEAR);
+SpscQueue<AlertEvent, ALERT_QUEUE_MAX> alertQueue;
+volatile uint32_t alertQueueDrops = 0;
+IbiEwma alertIbi(ALERT_BPM_EWMA_SHIFT);
+uint8_t alertIbis = 0;        // IBIs seguidos na EWMA
+LatencyStat latencyAlert;     // evento do sensor -> publish do alerta
+
+volatile bool CONNECTED = false;   // estado de conectividade (escrito pela rede, lido pelo sensoriamento)
+
+// Controle de tempo: cada laço tem sua agenda de prazos (scheduler.h) e só
+// ele mexe nela; o laço dorme até o primeiro prazo
+Scheduler<4> sensingJobs;   // DHT (início e passos), janela, emissão do BPM
+Scheduler<8> networkJobs;   // poll/retry do MQTT, drain, relatórios
+uint8_t jobDht, jobDhtStep, jobWindow, jobStream;
+uint8_t jobMqttPoll, jobMqttRetry, jobDrain, jobStats, jobProfile;
+void readDht();
+void dhtStepJob();
+void closeWindow();
+void emitBpmStream();
+void mqttPollJob();
+void drainJob();
+void printJitterReport();
+void profilePublishJob();
 
 // Amostras recentes
 float lastTemp = NAN;
 float lastHum  = NAN;
 int lastBpm    = 0;
 
+// --- Resumo estatístico da janela (sample_stats.h) ---
+// Média/desvio/extremos do DHT e SDNN/RMSSD dos IBIs, acumulados a cada
+// evento na tarefa de sensoriamento. Sai como campos opcionais no JSON da
+// janela ao vivo; o backlog guarda só a Sample.
+#ifndef WINDOW_STATS
+#define WINDOW_STATS 1
+#endif
+WindowStats windowStats;
+
+// --- Tarefas (dual-core) ---
+// Sensoriamento (DHT, janelas de BPM) e rede (serial, WiFi/MQTT, fila
+// offline) rodam em tarefas separadas, em cores distintos, ligadas por uma
+// fila SPSC sem lock. Um connect TLS ou um flush longo não atrasa mais o
+// fechamento das janelas. No native (ou com CARDIOIA_DUAL_CORE 0) as duas
+// etapas rodam em sequência no loop().
+#ifndef CARDIOIA_DUAL_CORE
+#ifdef ARDUINO
+#define CARDIOIA_DUAL_CORE 1
+#else
+#define CARDIOIA_DUAL_CORE 0
+#endif
+#endif
+static const int SENSING_CORE = 1;   // mesmo core do setup(): a ISR do botão fica aqui
+static const int NETWORK_CORE = 0;   // core da pilha WiFi/lwIP
+#if CARDIOIA_DUAL_CORE
+void sensingTask(void*);
+void networkTask(void*);
+void logTask(void*);
+#endif
+
+// --- Loop orientado a eventos ---
+// Em vez de girar consultando millis(), cada laço calcula o próximo prazo
+// (leitura do DHT, fechamento da janela, emissão do BPM, retry/keepalive do
+// MQTT, passo do drain, acks em voo) e dorme num HalEvent até ele, ou até a
+// ISR do botão, um byte no Serial, uma amostra nova ou o fim do connect o
+// acordarem antes. Os prazos são os mesmos das verificações "now - last >=
+// intervalo", então o sensoriamento não muda. LOOP_EVENT_DRIVEN 0 volta ao
+// giro contínuo (para comparar o duty cycle no relatório [SLEEP]).
+#ifndef LOOP_EVENT_DRIVEN
+#define LOOP_EVENT_DRIVEN 1
+#endif
+#ifndef NET_POLL_MS
+#define NET_POLL_MS 20           // sem evento a esperar (WiFi subindo, acks): consulta
+#endif
+#ifndef MQTT_IDLE_POLL_MS
+#define MQTT_IDLE_POLL_MS 1000   // mqtt.loop() ocioso (keepalive de 15 s)
+#endif
+#ifndef LOOP_MAX_SLEEP_MS
+#define LOOP_MAX_SLEEP_MS 1000
+#endif
+HalEvent sensingWake;            // ISR do botão
+#if CARDIOIA_DUAL_CORE
+HalEvent networkWake;            // amostra nova, Serial, fim do connect
+#else
+HalEvent& networkWake = sensingWake;
+#endif
+
+// Tempo dormindo e acordadas por laço; só o dono escreve, o relatório usa
+// diferenças (os contadores podem dar a volta)
+struct DutyCycle {
+  volatile uint32_t wakeups = 0;
+  volatile uint32_t sleptUs = 0;
+  uint32_t reportedWakeups = 0, reportedSleptUs = 0, reportedAtUs = 0;
+};
+DutyCycle sensingDuty;           // task de sensoriamento (dual-core)
+DutyCycle networkDuty;           // task de rede, ou o loop() inteiro
+
+// Milissegundos até due (0 se já passou), seguro na volta do millis()
+uint32_t msUntil(uint32_t now, uint32_t due) {
+  int32_t d = (int32_t)(due - now);
+  return d > 0 ? (uint32_t)d : 0;
+}
+
+void sleepUntilEvent(HalEvent& wake, DutyCycle& duty, uint32_t timeoutMs) {
+#if LOOP_EVENT_DRIVEN
+  if (timeoutMs > LOOP_MAX_SLEEP_MS) timeoutMs = LOOP_MAX_SLEEP_MS;
+#else
+  timeoutMs = CARDIOIA_DUAL_CORE ? 1 : 0;   // giro: as tasks só cedem o tick
+#endif
+  uint32_t t0 = micros();
+  wake.wait(timeoutMs);
+  duty.sleptUs += micros() - t0;
+  duty.wakeups++;
+}
+static const size_t SAMPLE_QUEUE_MAX = 32;  // ~5 min de janelas com a rede parada
+SpscQueue<SampleRecord, SAMPLE_QUEUE_MAX> sampleQueue;   // janela + resumo
+volatile uint32_t sampleQueueDrops = 0;
+
+// Jitter de janela: atraso do fechamento em relação ao prazo ideal
+static const uint32_t STATS_REPORT_MS = 60000;  // relatório a cada 1 min (6 janelas)
+volatile uint32_t jitterWindows = 0;
+volatile uint32_t jitterMaxMs = 0;
+volatile uint32_t jitterSumMs = 0;
+
 // MQTT client (TLS)
 WiFiClientSecure tlsClient;
 PubSubClient mqtt(tlsClient);
 unsigned long mqttBackoffMs = 1000;     // backoff inicial 1s
-unsigned long mqttNextRetry = 0;        // millis para próxima tentativa
 String mqttClientId;
 
+// --- Connect MQTT assíncrono ---
+// DNS + TCP + handshake TLS levam segundos. Com MQTT_CONNECT_ASYNC o connect()
+// roda numa task própria e a etapa de rede só consulta o resultado; enquanto
+// ele corre, ninguém mais toca em mqtt/tlsClient. Com 0 volta ao connect
+// síncrono (para comparar o pior caso do loop).
+#ifndef MQTT_CONNECT_ASYNC
+#define MQTT_CONNECT_ASYNC 1
+#endif
+// Teto de uma tentativa (handshake TLS e espera do CONNACK), em segundos
+#ifndef MQTT_CONNECT_TIMEOUT_S
+#define MQTT_CONNECT_TIMEOUT_S 5
+#endif
+enum MqttConnectState : uint8_t { MQTT_CONN_IDLE, MQTT_CONN_RUNNING, MQTT_CONN_OK, MQTT_CONN_FAIL };
+std::atomic<uint8_t> mqttConnectState{MQTT_CONN_IDLE};
+unsigned long mqttConnectStartMs = 0;
+
+// Conectado e sem connect em andamento na task
+bool mqttReady() {
+  return mqttConnectState.load(std::memory_order_acquire) != MQTT_CONN_RUNNING &&
+         mqtt.connected();
+}
+
+// --- Orçamento do loop ---
+// Tempo de cada iteração (sensoriamento + rede, ou só rede com duas tasks) e
+// quantas passaram do orçamento, zerados a cada relatório de jitter. Durante
+// um drain do backlog as iterações vão também para drainLoopHist.
+#ifndef LOOP_BUDGET_MS
+#define LOOP_BUDGET_MS 20
+#endif
+LatencyHist loopHist;
+uint32_t loopOverBudget = 0;
+bool drainActive = false;
+LatencyHist drainLoopHist;
+
+void loopIterDone(uint32_t elapsedUs) {
+  loopHist.add(elapsedUs);
+  if (drainActive) drainLoopHist.add(elapsedUs);
+  if (elapsedUs > LOOP_BUDGET_MS * 1000UL) loopOverBudget++;
+}
+
 // --- Fila em RAM (offline buffer) ---
-static const size_t RAM_QUEUE_MAX = 200; // ~200 amostras (~33 minutos em janelas de 10s)
-String ramQueue[RAM_QUEUE_MAX];
-size_t ramHead = 0, ramTail = 0, ramCount = 0;
+// Amostras binárias (13 bytes cada com o encadeamento) em fila estática,
+// sem fragmentar o heap. O JSON só é montado no flush. Janelas de alerta
+// (febre, taquicardia) têm prioridade (sample_queue.h): sob pressão as
+// normais saem antes (para os blocos comprimidos, a flash, os agregados ou
+// descartadas), e na reconexão os alertas saem primeiro.
+//
+// Blocos comprimidos (sample_block.h): com a fila cheia, a normal mais
+// antiga vai para blocos com deltas em varint, ~4 bytes por janela em vez
+// de 13. Com os blocos cheios, o bloco mais antigo inteiro desce para a
+// flash (ou para os agregados sem ela). Nos ~19 KB que antes eram 1440
+// posições (~4 h), ficam 240 posições + 60 blocos de 256 bytes: ~4000
+// janelas (~11 h). RAM_BLOCKS 0 volta à fila de 1440.
+#ifndef RAM_BLOCKS
+#define RAM_BLOCKS 1
+#endif
+#ifndef RAM_BLOCK_COUNT
+#define RAM_BLOCK_COUNT 60
+#endif
+#ifndef RAM_BLOCK_BYTES
+#define RAM_BLOCK_BYTES 256
+#endif
+#ifndef RAM_QUEUE_MAX
+#if RAM_BLOCKS
+#define RAM_QUEUE_MAX 240
+#else
+#define RAM_QUEUE_MAX 1440
+#endif
+#endif
+// --- Compactação do backlog (sample_agg.h) ---
+// Sem flash (ou com ela cheia), a normal mais antiga da RAM cheia vira parte
+// de um agregado em vez de ser descartada: janelas de 1 min nos primeiros
+// registros, 4x mais largas a cada nível. Com 4 níveis de 32 registros
+// (~4 KB) cabem ~45 h até o último nível, que segue juntando os mais
+// antigos. Os agregados são mais antigos que os blocos e as normais da RAM e
+// mais novos que a flash, e saem entre as duas. RAM_COMPACT 0 volta ao
+// descarte.
+#ifndef RAM_COMPACT
+#define RAM_COMPACT 1
+#endif
+#ifndef RAM_COMPACT_LEVELS
+#define RAM_COMPACT_LEVELS 4
+#endif
+#ifndef RAM_COMPACT_PER_LEVEL
+#define RAM_COMPACT_PER_LEVEL 32
+#endif
+#ifndef RAM_COMPACT_BASE
+#define RAM_COMPACT_BASE 6   // janelas por agregado no nível 0
+#endif
+
+// --- Flush em lotes ---
+// O backlog sai em payloads JSON array ([{...},{...}]) de até
+// FLUSH_BATCH_MAX_SAMPLES amostras e FLUSH_BATCH_MAX_BYTES bytes: um PUBLISH
+// por lote em vez de um por amostra. Lote de uma amostra sai como objeto
+// simples, então FLUSH_BATCH_MAX_SAMPLES = 1 reproduz o comportamento
+// anterior (útil para comparar tempo de drain e bytes).
+// O payload é serializado direto no socket (beginPublish/write/endPublish),
+// então o lote não é limitado pelo buffer interno do PubSubClient.
+#ifndef FLUSH_BATCH_MAX_SAMPLES
+#define FLUSH_BATCH_MAX_SAMPLES 60
+#endif
+#ifndef FLUSH_BATCH_MAX_BYTES
+#define FLUSH_BATCH_MAX_BYTES 4096
+#endif
+static_assert(FLUSH_BATCH_MAX_BYTES >= RECORD_JSON_MAX + 2, "lote menor que uma amostra");
+
+// --- Backlog retido entre resets (retained.h) ---
+// Fila, blocos e agregados ficam juntos em memória HAL_NOINIT, atrás de um
+// cabeçalho com magic e CRC-32 por segmento de 512 bytes. Cada mudança sela
+// só a parte que mexeu (a fila num enfileiramento, o cabeçalho da mensagem
+// num envio), antes de qualquer publish. Depois de um panic, watchdog, reset
+// por software ou brownout que preserve a RAM, o setup() valida e retoma o
+// drain sem passar pela flash; num power-on, RAM corrompida ou firmware com
+// outro layout o restore falha e o backlog começa vazio. A janela de entrega
+// fica na mesma região: uma amostra só sai do estado retido com o ack, e o
+// que estava em voo é reenviado no boot seguinte. RAM_RETAIN 0 volta à RAM
+// comum.
+#ifndef RAM_RETAIN
+#define RAM_RETAIN 1
+#endif
+static const uint16_t RAM_RETAIN_VERSION = 3;   // mudar junto com o layout de RamBacklog
 
-void ramEnqueue(const String& line) {
-  if (ramCount == RAM_QUEUE_MAX) {
-    // descarta a mais antiga (ring buffer)
-    ramTail = (ramTail + 1) % RAM_QUEUE_MAX;
-    ramCount--;
+#if DELIVERY_ACK
+typedef DeliveryWindow<DELIVERY_WINDOW, FLUSH_BATCH_MAX_SAMPLES> Delivery;
+#endif
+
+struct RamBacklog {
+  SampleQueue<RAM_QUEUE_MAX> queue;
+#if RAM_BLOCKS
+  SampleBlockLog<RAM_BLOCK_COUNT, RAM_BLOCK_BYTES> blocks{BPM_WINDOW_MS};
+#endif
+#if RAM_COMPACT
+  SampleCompactor<RAM_COMPACT_LEVELS, RAM_COMPACT_PER_LEVEL> compactor{RAM_COMPACT_BASE};
+#endif
+#if DELIVERY_ACK
+  Delivery delivery;   // publicadas e sem ack
+#endif
+
+  bool valid() const {
+    bool ok = queue.valid();
+#if RAM_BLOCKS
+    ok = ok && blocks.valid();
+#endif
+#if RAM_COMPACT
+    ok = ok && compactor.valid();
+#endif
+#if DELIVERY_ACK
+    ok = ok && delivery.valid();
+#endif
+    return ok;
   }
-  ramQueue[ramHead] = line;
-  ramHead = (ramHead + 1) % RAM_QUEUE_MAX;
-  ramCount++;
+};
+
+#if RAM_RETAIN
+HAL_NOINIT Retained<RamBacklog, RAM_RETAIN_VERSION> ramRetained;
+RamBacklog& ramBacklog = ramRetained.get();
+#else
+RamBacklog ramBacklog;
+#endif
+SampleQueue<RAM_QUEUE_MAX>& ramQueue = ramBacklog.queue;
+#if RAM_BLOCKS
+SampleBlockLog<RAM_BLOCK_COUNT, RAM_BLOCK_BYTES>& ramBlocks = ramBacklog.blocks;
+#endif
+#if RAM_COMPACT
+SampleCompactor<RAM_COMPACT_LEVELS, RAM_COMPACT_PER_LEVEL>& compactor = ramBacklog.compactor;
+#endif
+#if DELIVERY_ACK
+Delivery& delivery = ramBacklog.delivery;
+#endif
+
+// Depois de mudar o backlog em RAM: o próximo restore vê este estado. Sela
+// só a parte indicada (um membro de RamBacklog ou um trecho dele).
+void ramBacklogSeal(const void* part, size_t len) {
+#if RAM_RETAIN
+  ramRetained.seal(part, len);
+#else
+  (void)part;
+  (void)len;
+#endif
 }
 
-size_t ramFlushPublish() {
-  size_t sent = 0;
-  while (ramCount > 0 && mqtt.connected()) {
-    String line = ramQueue[ramTail];
-    ramTail = (ramTail + 1) % RAM_QUEUE_MAX;
-    ramCount--;
-    bool ok = mqtt.publish(MQTT_TOPIC, line.c_str());
-    if (ok) {
-      sent++;
-    } else {
-      // se falhar, interrompe para tentar depois
-      // reposiciona ponteiro para tentar novamente no futuro
-      ramTail = (ramTail + RAM_QUEUE_MAX - 1) % RAM_QUEUE_MAX;
-      ramCount++;
+template <typename P>
+void ramBacklogSeal(const P& part) {
+  ramBacklogSeal(&part, sizeof(part));
+}
+
+// Boot: backlog em RAM do boot anterior, se íntegro; senão começa vazio
+void ramBacklogRestore() {
+#if RAM_RETAIN
+  uint32_t t0 = micros();
+  RetainStatus st = ramRetained.restore();
+  if (st == RETAIN_OK && !ramBacklog.valid()) st = RETAIN_BAD_STATE;
+  if (st != RETAIN_OK) ramRetained.reset();
+  size_t blocks = 0, aggs = 0, inFlight = 0;
+#if RAM_BLOCKS
+  blocks = ramBlocks.size();
+#endif
+#if RAM_COMPACT
+  aggs = compactor.size();
+#endif
+#if DELIVERY_ACK
+  // O que estava em voo sai de novo, com o seq de antes, no boot novo
+  delivery.markUnsent();
+  ramBacklogSeal(delivery);
+  inFlight = delivery.samples();
+#endif
+  logPrintf(st == RETAIN_OK || st == RETAIN_EMPTY ? LOG_INFO : LOG_WARN,
+            "RAM_RESTORE status=%s fila=%lu blocos=%lu agregados=%lu janela=%lu us=%lu", retainStatusName(st),
+            (unsigned long)ramQueue.size(), (unsigned long)blocks, (unsigned long)aggs,
+            (unsigned long)inFlight, (unsigned long)(micros() - t0));
+#endif
+}
+
+// --- Spillover em flash (LittleFS; diretório local no native) ---
+// Com a RAM cheia, as amostras descem em lote para o log em flash, que
+// sobrevive a reboot: as normais mais antigas primeiro, alertas só quando a
+// RAM não tem mais nada. As normais na flash são mais antigas do que as da
+// RAM, então o flush drena os alertas da RAM, depois a flash e depois as
+// normais da RAM. Com RAM_BLOCKS, o que desce são os blocos mais antigos.
+static const size_t RAM_SPILL_BATCH = 32;
+FlashLog flashLog(halLogStorage());
+
+uint32_t spillDropped = 0;   // sem flash nem compactação
+
+// Lote que sai da RAM: para a flash; sem ela (ou com falha), para os agregados
+void backlogSpill(const Sample* batch, size_t n) {
+  if (flashLog.ready()) {
+    if (flashLog.append(batch, n)) return;
+    logWrite(LOG_WARN, "[WARN] FLASH_SPILL_FAIL");
+  }
+#if RAM_COMPACT
+  for (size_t i = 0; i < n; i++) compactor.add(batch[i]);
+  ramBacklogSeal(compactor);
+#else
+  spillDropped += n;
+  logPrintf(LOG_WARN, "[WARN] RAM_SPILL_DROP total=%lu", (unsigned long)spillDropped);
+#endif
+}
+
+#if RAM_BLOCKS
+// Blocos cheios: o mais antigo desce inteiro, em lotes de RAM_SPILL_BATCH
+void ramBlocksPush(const Sample& sample) {
+  if (ramBlocks.full()) {
+    Sample batch[RAM_SPILL_BATCH];
+    size_t n = 0;
+    ramBlocks.evictBlock([&](const Sample& s) {
+      batch[n++] = s;
+      if (n == RAM_SPILL_BATCH) {
+        backlogSpill(batch, n);
+        n = 0;
+      }
+    });
+    if (n) backlogSpill(batch, n);
+  }
+  ramBlocks.push(sample);
+}
+#endif
+
+void ramSpillToFlash() {
+  Sample batch[RAM_SPILL_BATCH];
+  size_t n = 0;
+  // Alertas só descem se a RAM não tiver nenhuma normal
+  size_t keep = ramQueue.alerts() < ramQueue.size() ? ramQueue.alerts() : 0;
+  while (n < RAM_SPILL_BATCH && ramQueue.size() > keep && ramQueue.popEvictable(batch[n])) n++;
+  backlogSpill(batch, n);
+}
+
+void ramEnqueue(const Sample& sample) {
+#if RAM_BLOCKS
+  if (ramQueue.full()) {
+    // Normal com a RAM só de alertas: é a mais nova e vai direto
+    if (!sampleIsAlert(sample) && ramQueue.alerts() == ramQueue.size()) {
+      ramBlocksPush(sample);
+      ramBacklogSeal(ramBlocks);
+      return;
+    }
+    Sample old;
+    if (ramQueue.popEvictable(old)) ramBlocksPush(old);
+    ramBacklogSeal(ramBlocks);
+  }
+#else
+  if (ramQueue.full() && flashLog.ready()) {
+    ramSpillToFlash();
+  }
+#if RAM_COMPACT
+  if (ramQueue.full()) {
+    // Normal com a RAM só de alertas: é a mais nova e vai direto
+    if (!sampleIsAlert(sample) && ramQueue.alerts() == ramQueue.size()) {
+      compactor.add(sample);
+      ramBacklogSeal(compactor);
+      return;
+    }
+    Sample old;
+    if (ramQueue.popEvictable(old)) compactor.add(old);
+    ramBacklogSeal(compactor);
+  }
+#endif
+#endif
+  // Sem blocos, compactação nem flash, a fila descarta pela prioridade
+  if (!ramQueue.push(sample)) {
+    logPrintf(LOG_WARN, "[WARN] RAM_QUEUE_DROP normais=%lu alertas=%lu",
+              (unsigned long)ramQueue.droppedNormal(), (unsigned long)ramQueue.droppedAlert());
+  }
+  ramBacklogSeal(ramQueue);
+}
+
+// Amostras já retiradas da fila e ainda não confirmadas pelo publish.
+// Se o publish falhar, o lote fica aqui e é o primeiro a sair no próximo flush.
+SampleRecord flushBatch[FLUSH_BATCH_MAX_SAMPLES];
+size_t flushBatchLen = 0;
+size_t flushBatchItemBytes = 0;   // soma dos JSON das amostras do lote
+size_t flushBatchFromFlash = 0;   // quantas vieram do log em flash
+
+// Partes do backlog retido de onde o lote tirou amostras, ainda sem seal
+enum : uint8_t { POPPED_QUEUE = 1, POPPED_BLOCKS = 2, POPPED_COMPACT = 4 };
+uint8_t flushBatchPopped = 0;
+
+#if DELIVERY_ACK
+uint32_t deliveryBoot = 0;        // id do boot: o consumidor reinicia a deduplicação
+uint32_t deliveryResends = 0;
+#endif
+
+// Ainda não publicadas (flash, RAM, blocos, agregados e lote em montagem)
+size_t queuedSize() {
+  size_t n = flashLog.size() + ramQueue.size() + flushBatchLen;
+#if RAM_BLOCKS
+  n += ramBlocks.size();
+#endif
+#if RAM_COMPACT
+  n += compactor.size();
+#endif
+  return n;
+}
+
+// Tudo que ainda não tem entrega confirmada
+size_t backlogSize() {
+#if DELIVERY_ACK
+  return queuedSize() + delivery.samples();
+#else
+  return queuedSize();
+#endif
+}
+
+// Tamanho exato do payload: objeto simples, ou "[" + itens com "," + "]"
+size_t flushPayloadLen(size_t count, size_t itemBytes) {
+  return count <= 1 ? itemBytes : itemBytes + count + 1;
+}
+
+// Envelope com seq: head + "[" + itens com "," + "]" + "}"
+size_t envelopePayloadLen(size_t headLen, size_t count, size_t itemBytes) {
+  return headLen + itemBytes + count + 2;
+}
+
+enum BacklogSource : uint8_t { FROM_NONE, FROM_RAM, FROM_FLASH, FROM_COMPACT, FROM_BLOCK };
+
+// Próximo item na ordem de saída: alertas da RAM, flash, agregados, blocos,
+// normais da RAM
+BacklogSource backlogPeek(SampleRecord& rec) {
+  Sample sample;
+  if (ramQueue.alerts() == 0 && flashLog.peek(sample)) {
+    rec = sampleRecord(sample);
+    return FROM_FLASH;
+  }
+#if RAM_COMPACT
+  if (ramQueue.alerts() == 0 && compactor.peek(rec)) return FROM_COMPACT;
+#endif
+#if RAM_BLOCKS
+  if (ramQueue.alerts() == 0 && ramBlocks.peek(sample)) {
+    rec = sampleRecord(sample);
+    return FROM_BLOCK;
+  }
+#endif
+  if (!ramQueue.peek(sample)) return FROM_NONE;
+  rec = sampleRecord(sample);
+  return FROM_RAM;
+}
+
+// Completa o lote pendente na ordem de saída, até maxSamples (e
+// FLUSH_BATCH_MAX_SAMPLES) no lote
+void flushBatchFill(size_t maxSamples) {
+  SampleRecord rec;
+  char line[RECORD_JSON_MAX];
+  if (maxSamples > FLUSH_BATCH_MAX_SAMPLES) maxSamples = FLUSH_BATCH_MAX_SAMPLES;
+  while (flushBatchLen < maxSamples) {
+    BacklogSource from = backlogPeek(rec);
+    if (from == FROM_NONE) break;
+    size_t len = formatRecordJson(line, sizeof(line), rec);
+    if (flushBatchLen > 0 &&
+        flushPayloadLen(flushBatchLen + 1, flushBatchItemBytes + len) > FLUSH_BATCH_MAX_BYTES) {
       break;
     }
+    flushBatch[flushBatchLen++] = rec;
+    flushBatchItemBytes += len;
+    if (from == FROM_FLASH) {
+      flashLog.pop();
+      flushBatchFromFlash++;
+    }
+#if RAM_COMPACT
+    else if (from == FROM_COMPACT) {
+      compactor.pop();
+      flushBatchPopped |= POPPED_COMPACT;
+    }
+#endif
+#if RAM_BLOCKS
+    else if (from == FROM_BLOCK) {
+      ramBlocks.pop();
+      flushBatchPopped |= POPPED_BLOCKS;
+    }
+#endif
+    else {
+      ramQueue.pop();
+      flushBatchPopped |= POPPED_QUEUE;
+    }
+  }
+}
+
+// Sela as partes de onde flushBatchFill() tirou amostras
+void flushBatchSealSources() {
+  if (flushBatchPopped & POPPED_QUEUE) ramBacklogSeal(ramQueue);
+#if RAM_BLOCKS
+  if (flushBatchPopped & POPPED_BLOCKS) ramBacklogSeal(ramBlocks);
+#endif
+#if RAM_COMPACT
+  if (flushBatchPopped & POPPED_COMPACT) ramBacklogSeal(compactor);
+#endif
+  flushBatchPopped = 0;
+}
+
+// --- Publish em streaming ---
+// Serializa o lote direto no stream do cliente, sem montar o payload inteiro.
+// As amostras passam por um bloco pequeno antes do write(): no
+// WiFiClientSecure cada write() vira um registro TLS, então escrever amostra
+// por amostra multiplicaria o overhead.
+static const size_t MQTT_STREAM_CHUNK = 512;
+static const size_t MQTT_ENVELOPE_HEAD_MAX = 72;
+static_assert(MQTT_STREAM_CHUNK >= MQTT_ENVELOPE_HEAD_MAX + RECORD_JSON_MAX + 4, "bloco menor que uma amostra");
+
+bool mqttStreamFlushChunk(const char* chunk, size_t& used) {
+  if (used == 0) return true;
+  size_t n = mqtt.write((const uint8_t*)chunk, used);
+  bool ok = n == used;
+  used = 0;
+  return ok;
+}
+
+// head (opcional) abre o envelope de entrega; o lote vira sempre array
+bool mqttPublishBatchStream(const char* topic, const SampleRecord* samples, size_t count, size_t payloadLen,
+                            const char* head) {
+  if (!mqtt.beginPublish(topic, payloadLen, false)) return false;
+  char chunk[MQTT_STREAM_CHUNK];
+  size_t used = 0, written = 0;
+  bool ok = true;
+  bool array = count > 1 || head;
+  if (head) {
+    used = strlen(head);
+    memcpy(chunk, head, used);
+  }
+  if (array) chunk[used++] = '[';
+  for (size_t i = 0; i < count && ok; i++) {
+    if (MQTT_STREAM_CHUNK - used < RECORD_JSON_MAX + 3) {
+      written += used;
+      ok = mqttStreamFlushChunk(chunk, used);
+    }
+    if (array && i > 0) chunk[used++] = ',';
+    used += formatRecordJson(chunk + used, MQTT_STREAM_CHUNK - used, samples[i]);
+  }
+  if (array) chunk[used++] = ']';
+  if (head) chunk[used++] = '}';
+  written += used;
+  ok = ok && mqttStreamFlushChunk(chunk, used);
+  if (!ok || written != payloadLen) {
+    // Frame incompleto no socket: derruba a conexão em vez de corromper o stream
+    tlsClient.stop();
+    return false;
+  }
+  return mqtt.endPublish() == 1;
+}
+
+// Bytes do frame MQTT PUBLISH QoS 0 (sem o overhead do TLS)
+size_t mqttPublishFrameBytes(size_t topicLen, size_t payloadLen) {
+  size_t remaining = 2 + topicLen + payloadLen;
+  size_t lenBytes = remaining < 128 ? 1 : remaining < 16384 ? 2 : 3;
+  return 1 + lenBytes + remaining;
+}
+
+// Agregados vão só com as médias e a flag SAMPLE_F_AGG; os extremos e a
+// contagem ficam no JSON. Com env, o lote leva o envelope da entrega (v2).
+bool mqttPublishBinary(const SampleRecord* samples, size_t count, size_t& len, const WireEnvelope* env) {
+  uint8_t buf[wireBatchMax(FLUSH_BATCH_MAX_SAMPLES)];
+  Sample plain[FLUSH_BATCH_MAX_SAMPLES];
+  for (size_t i = 0; i < count; i++) plain[i] = recordSample(samples[i]);
+  len = wireEncodeBatch(plain, count, buf, env);
+  if (!mqtt.beginPublish(MQTT_TOPIC_BIN, len, false)) return false;
+  if (mqtt.write(buf, len) != len) {
+    tlsClient.stop();
+    return false;
+  }
+  return mqtt.endPublish() == 1;
+}
+
+// Publica amostras no(s) formato(s) configurado(s); soma em wire os bytes
+// dos frames MQTT enviados. jsonLen = flushPayloadLen() das amostras, ou
+// envelopePayloadLen() com head; env é o mesmo envelope para o binário.
+bool mqttPublishSamples(const SampleRecord* samples, size_t count, size_t jsonLen, size_t& wire,
+                        const char* head = nullptr, const WireEnvelope* env = nullptr) {
+  PROFILE_SCOPE(PROF_PUBLISH);
+  bool ok = true;
+#if WIRE_FORMAT & WIRE_JSON
+  ok = mqttPublishBatchStream(MQTT_TOPIC, samples, count, jsonLen, head);
+  if (!ok) return false;
+  wire += mqttPublishFrameBytes(strlen(MQTT_TOPIC), jsonLen);
+#endif
+#if WIRE_FORMAT & WIRE_BINARY
+  size_t binLen = 0;
+  bool binOk = mqttPublishBinary(samples, count, binLen, env);
+  if (binOk) wire += mqttPublishFrameBytes(strlen(MQTT_TOPIC_BIN), binLen);
+#if !(WIRE_FORMAT & WIRE_JSON)
+  (void)jsonLen;
+  (void)head;
+  ok = binOk;
+#endif
+#else
+  (void)env;
+#endif
+  return ok;
+}
+
+// --- Drain incremental do backlog ---
+// Em vez de esvaziar tudo numa chamada, cada iteração da etapa de rede envia
+// no máximo DRAIN_STEP_MAX_SAMPLES amostras e para ao passar de
+// DRAIN_STEP_BUDGET_US, a uma taxa média de DRAIN_RATE_SPS amostras/s
+// (créditos acumulados com o tempo). Amostras ao vivo têm prioridade: saem
+// direto em processSample(), antes do passo de drain. Taxa ou orçamento 0
+// desligam o respectivo limite.
+#ifndef DRAIN_RATE_SPS
+#define DRAIN_RATE_SPS 20
+#endif
+#ifndef DRAIN_STEP_MAX_SAMPLES
+#define DRAIN_STEP_MAX_SAMPLES 20
+#endif
+#ifndef DRAIN_STEP_BUDGET_US
+#define DRAIN_STEP_BUDGET_US 5000
+#endif
+
+uint32_t drainCredit = 0;          // créditos em milésimos de amostra
+uint32_t drainLastRefillMs = 0;
+// Sessão de drain: do primeiro lote até o backlog esvaziar (log RAM_FLUSH)
+size_t drainSent = 0, drainMsgs = 0, drainWire = 0;
+uint32_t drainStartMs = 0;
+// Boot até o primeiro lote do backlog (log BOOT_FIRST_DRAIN, uma vez)
+uint32_t bootMs = 0;
+bool bootDrained = false;
+
+void drainKick();
+
+void drainRefill() {
+  uint32_t now = millis();
+  uint64_t credit = drainCredit + (uint64_t)(now - drainLastRefillMs) * DRAIN_RATE_SPS;
+  uint32_t cap = DRAIN_STEP_MAX_SAMPLES * 1000UL;
+  drainCredit = credit > cap ? cap : (uint32_t)credit;
+  drainLastRefillMs = now;
+}
+
+void drainSessionDone() {
+#if DELIVERY_ACK
+  logPrintf(LOG_INFO, "RAM_FLUSH %lu msgs=%lu bytes=%lu ms=%lu reenvios=%lu",
+            (unsigned long)drainSent, (unsigned long)drainMsgs, (unsigned long)drainWire,
+            (unsigned long)(millis() - drainStartMs), (unsigned long)deliveryResends);
+#else
+  logPrintf(LOG_INFO, "RAM_FLUSH %lu msgs=%lu bytes=%lu ms=%lu",
+            (unsigned long)drainSent, (unsigned long)drainMsgs, (unsigned long)drainWire,
+            (unsigned long)(millis() - drainStartMs));
+#endif
+  logPrintf(LOG_INFO, "[LOOP] drain iteracoes=%lu p50_us=%lu p99_us=%lu max_us=%lu",
+            (unsigned long)drainLoopHist.count(), (unsigned long)drainLoopHist.percentile(50),
+            (unsigned long)drainLoopHist.percentile(99), (unsigned long)drainLoopHist.max());
+  drainActive = false;
+}
+
+#if DELIVERY_ACK
+// Publica uma mensagem da janela com o envelope {"boot","seq","base","samples"}
+bool deliverySend(Delivery::Msg& m, size_t& wire) {
+  char head[MQTT_ENVELOPE_HEAD_MAX];
+  int headLen = snprintf(head, sizeof(head), "{\"boot\":%lu,\"seq\":%lu,\"base\":%lu,\"samples\":",
+                         (unsigned long)deliveryBoot, (unsigned long)m.seq, (unsigned long)delivery.baseSeq());
+  char line[RECORD_JSON_MAX];
+  size_t itemBytes = 0;
+  for (size_t i = 0; i < m.count; i++) itemBytes += formatRecordJson(line, sizeof(line), m.samples[i]);
+  size_t len = envelopePayloadLen(headLen, m.count, itemBytes);
+  if (m.tries > 0) deliveryResends++;
+  if (m.tries < UINT8_MAX) m.tries++;
+  // A janela é retida: o cabeçalho da mensagem é selado antes do publish
+  // (um reset durante o TLS não pode achar o CRC velho) e de novo depois
+  const size_t msgHead = offsetof(Delivery::Msg, samples);
+  ramBacklogSeal(&m, msgHead);
+  WireEnvelope env = {deliveryBoot, m.seq, delivery.baseSeq()};
+  bool ok = mqttPublishSamples(m.samples, m.count, len, wire, head, &env);
+  if (ok) {
+    m.sent = true;
+    m.sentMs = millis();
+    // Consulta os acks logo e volta para reenviar se não vier nenhum
+    networkJobs.atMost(jobMqttPoll, m.sentMs, NET_POLL_MS);
+    networkJobs.atMost(jobDrain, m.sentMs, DELIVERY_ACK_TIMEOUT_MS);
+    ramBacklogSeal(&m, msgHead);
+  }
+  return ok;
+}
+
+// Reenvia, em ordem, o que não saiu nesta conexão ou está sem ack há mais de
+// DELIVERY_ACK_TIMEOUT_MS (go-back-N: o ack é cumulativo)
+void deliveryResendDue(size_t& wire) {
+  uint32_t now = millis();
+  for (size_t i = 0; i < delivery.msgs(); i++) {
+    Delivery::Msg& m = delivery.at(i);
+    if (m.sent && now - m.sentMs < DELIVERY_ACK_TIMEOUT_MS) continue;
+    if (!deliverySend(m, wire)) return;
+  }
+}
+
+// Ack do consumidor: libera a janela e grava no log a posição de tudo o que
+// saiu da flash e já teve ack. As amostras da flash ainda na janela ficam
+// depois da posição gravada: o boot seguinte as pula (estão na janela
+// retida) ou, sem ela, as lê de novo.
+void deliveryAck(uint32_t seq) {
+  size_t flashBefore = delivery.flashSamples();
+  if (delivery.ack(seq) == 0) return;
+  if (delivery.flashSamples() < flashBefore) flashLog.commit(delivery.flashSamples() + flushBatchFromFlash);
+  ramBacklogSeal(delivery);
+  drainKick();
+}
+
+void onMqttMessage(char* topic, uint8_t* payload, unsigned int len) {
+  if (strcmp(topic, MQTT_TOPIC_ACK) != 0) return;
+  char buf[64];
+  if (len >= sizeof(buf)) return;
+  memcpy(buf, payload, len);
+  buf[len] = '\0';
+  const char* boot = strstr(buf, "\"boot\":");
+  const char* seq = strstr(buf, "\"seq\":");
+  if (!boot || !seq) return;
+  if (strtoul(boot + 7, nullptr, 10) != deliveryBoot) return; // ack de outro boot
+  deliveryAck(strtoul(seq + 6, nullptr, 10));
+}
+#endif
+
+size_t ramDrainStep() {
+  PROFILE_SCOPE(PROF_DRAIN);
+  drainRefill();
+  // Fecha a sessão na iteração seguinte ao último lote, para que ela entre
+  // no histograma de drainLoopHist
+  if (drainActive && backlogSize() == 0) drainSessionDone();
+  if (!mqttReady()) return 0;
+#if DELIVERY_ACK
+  deliveryResendDue(drainWire);
+#endif
+  size_t pending = queuedSize();
+  if (pending == 0) return 0;
+
+  size_t quota = DRAIN_STEP_MAX_SAMPLES;
+  if (pending < quota) quota = pending;
+  // Espera crédito para um passo inteiro: lotes maiores, menos PUBLISH
+  if (DRAIN_RATE_SPS > 0 && drainCredit < quota * 1000UL) return 0;
+
+  if (!drainActive) {
+    drainActive = true;
+    drainSent = drainMsgs = drainWire = 0;
+    drainStartMs = millis();
+    drainLoopHist.reset();
   }
-  if (sent > 0) {
-    Serial.print(F("RAM_FLUSH ")); Serial.println((unsigned long)sent);
+  uint32_t t0 = micros();
+  size_t sent = 0;
+  while (sent < quota) {
+#if DELIVERY_ACK
+    if (delivery.full()) break;
+#endif
+    flushBatchFill(quota - sent);
+    if (flushBatchLen == 0) break;
+#if DELIVERY_ACK
+    // O lote entra na janela antes do publish e só sai dela com o ack; se o
+    // publish falhar, é reenviado em deliveryResendDue()
+    Delivery::Msg* m = delivery.push(flushBatch, flushBatchLen, flushBatchFromFlash);
+    sent += flushBatchLen;
+    drainMsgs++;
+    flushBatchLen = 0;
+    flushBatchItemBytes = 0;
+    flushBatchFromFlash = 0;
+    // Janela antes das fontes: um reset entre os dois seals duplica o lote
+    // em vez de perdê-lo
+    ramBacklogSeal(delivery);
+    flushBatchSealSources();
+    if (!deliverySend(*m, drainWire)) break;
+#else
+    flushBatchSealSources();
+    size_t len = flushPayloadLen(flushBatchLen, flushBatchItemBytes);
+    bool ok = mqttPublishSamples(flushBatch, flushBatchLen, len, drainWire);
+    if (!ok) break; // se falhar, mantém o lote para tentar depois
+    sent += flushBatchLen;
+    drainMsgs++;
+    flushBatchLen = 0;
+    flushBatchItemBytes = 0;
+    flushBatchFromFlash = 0;
+    flashLog.commit();
+#endif
+    if (DRAIN_STEP_BUDGET_US > 0 && micros() - t0 >= DRAIN_STEP_BUDGET_US) break;
   }
+  if (sent && !bootDrained) {
+    bootDrained = true;
+    logPrintf(LOG_INFO, "BOOT_FIRST_DRAIN ms=%lu backlog=%lu", (unsigned long)(millis() - bootMs),
+              (unsigned long)backlogSize());
+  }
+  uint32_t spent = sent * 1000UL;
+  drainCredit = spent < drainCredit ? drainCredit - spent : 0;
+  drainSent += sent;
   return sent;
 }
 
-// --- ISR de pulso no botão (conta borda de subida) ---
+// Espera até haver crédito para um passo inteiro de drain
+uint32_t drainCreditWaitMs() {
+  size_t quota = queuedSize();
+  if (quota > DRAIN_STEP_MAX_SAMPLES) quota = DRAIN_STEP_MAX_SAMPLES;
+  uint32_t need = quota * 1000UL;
+  if (DRAIN_RATE_SPS == 0 || drainCredit >= need) return 0;
+  return (need - drainCredit + DRAIN_RATE_SPS - 1) / DRAIN_RATE_SPS;
+}
+
+// Quando o próximo passo de drain tem trabalho: fechar a sessão, reenviar
+// por timeout ou mandar mais backlog. UINT32_MAX = nada até um drainKick().
+uint32_t drainNextMs() {
+  if (drainActive && backlogSize() == 0) return 0;
+  if (!mqttReady()) return UINT32_MAX;
+  uint32_t wait = UINT32_MAX;
+#if DELIVERY_ACK
+  uint32_t now = millis();
+  for (size_t i = 0; i < delivery.msgs(); i++) {
+    const Delivery::Msg& m = delivery.at(i);
+    uint32_t due = m.sent ? msUntil(now, m.sentMs + DELIVERY_ACK_TIMEOUT_MS) : 0;
+    if (due < wait) wait = due;
+  }
+  if (delivery.full()) return wait;   // o ack chama drainKick()
+#endif
+  if (queuedSize() > 0) {
+    uint32_t credit = drainCreditWaitMs();
+    if (credit < wait) wait = credit;
+  }
+  return wait;
+}
+
+// Job de drain: um passo e reagenda pelo que falta
+void drainJob() {
+  if (!CONNECTED) return;   // ONLINE chama drainKick()
+  ramDrainStep();
+  uint32_t wait = drainNextMs();
+  if (wait != UINT32_MAX) networkJobs.after(jobDrain, millis(), wait);
+}
+
+// Backlog novo, conexão nova ou janela liberada: drain na próxima iteração
+void drainKick() { networkJobs.atMost(jobDrain, millis(), 0); }
+
+// --- ISR de pulso no botão (timestamp da borda de subida) ---
 void IRAM_ATTR onButtonChange() {
   int state = digitalRead(PIN_BTN);
   if (state == HIGH && lastBtnState == LOW) {
-    pulseCount++;
+    if (beatQueue.push(micros())) sensingWake.signalFromIsr();
+    else beatQueueDrops++;
   }
   lastBtnState = state;
 }
 
-// --- Leitura do DHT com proteção simples ---
-void readDhtIfDue() {
-  uint32_t now = millis();
-  if (now - lastDhtRead >= DHT_INTERVAL_MS) {
-    lastDhtRead = now;
-    TempAndHumidity th = dht.getTempAndHumidity();
-    if (!isnan(th.temperature) && !isnan(th.humidity)) {
-      lastTemp = th.temperature;
-      lastHum  = th.humidity;
-      // Exibe leituras no Serial Monitor (Wokwi)
-      Serial.print(F("TEMP(")); Serial.print(PIN_DHT); Serial.print(F(")= "));
-      Serial.print(lastTemp, 2);
-      Serial.print(F(" °C  HUM= "));
-      Serial.print(lastHum, 2);
-      Serial.println(F(" %"));
-    } else {
-      // Mantém últimos valores válidos
+// --- Avalia uma regra de alerta; transições vão para a rede ---
+void alertUpdate(uint8_t rule, int32_t value, uint32_t eventUs) {
+  if (!ALERT_ENGINE) return;
+  AlertEvent ev;
+  if (!alertEngine.update(rule, value, millis(), eventUs, ev)) return;
+  if (!alertQueue.push(ev)) {
+    alertQueueDrops++;
+    return;
+  }
+#if CARDIOIA_DUAL_CORE
+  networkWake.signal();
+#endif
+}
+
+// BPM do alerta a cada batimento; gap = primeiro batimento ou pausa longa
+void alertBeat(uint32_t ibi, bool gap, uint32_t beatUs) {
+  if (!ALERT_ENGINE) return;
+  if (gap) {
+    alertIbi.reset();
+    alertIbis = 0;
+    return;
+  }
+  alertIbi.addIbi(ibi);
+  if (alertIbis < ALERT_BPM_MIN_IBIS) alertIbis++;
+  if (alertIbis < ALERT_BPM_MIN_IBIS) return;
+  alertUpdate(ALERT_BPM, (int32_t)lroundf(alertIbi.bpm() * 10.0f), beatUs);
+}
+
+// --- Leitura do DHT com proteção simples (job a cada DHT_INTERVAL_MS) ---
+void applyDhtReading(float temperature, float humidity) {
+  if (!isnan(temperature) && !isnan(humidity)) {
+    lastTemp = temperature;
+    lastHum  = humidity;
+    if (WINDOW_STATS) windowStats.addDht(temperature, humidity);
+    alertUpdate(ALERT_TEMP, (int32_t)rint((double)temperature * 100.0), micros());
+    // Exibe leituras no Serial Monitor (Wokwi)
+    logPrintf(LOG_INFO, "TEMP(%d)= %.2f °C  HUM= %.2f %%", PIN_DHT, lastTemp, lastHum);
+  } else {
+    // Mantém últimos valores válidos
+  }
+}
+
+#if DHT_ASYNC
+// Começa uma leitura; os passos seguintes rodam no jobDhtStep
+void readDht() {
+  if (dhtAsyncBusy()) return;   // a anterior ainda não terminou
+  dhtStepJob();
+}
+
+void dhtStepJob() {
+  DhtReading r;
+  uint32_t wait;
+  {
+    PROFILE_SCOPE(PROF_DHT);
+    wait = dhtAsyncStep(r);
+  }
+  if (wait) {
+    sensingJobs.after(jobDhtStep, millis(), wait);
+    return;
+  }
+  if (r.status == DHT_OK) applyDhtReading(r.temperature, r.humidity);
+  else logPrintf(LOG_DEBUG, "[DHT] erro=%s", dhtStatusName(r.status));
+}
+
+void printDhtReport() {
+  char line[LOG_LINE_MAX];
+  size_t n = snprintf(line, sizeof(line), "[DHT]");
+  for (uint8_t s = 0; s < DHT_STATUS_COUNT && n < sizeof(line); s++) {
+    n += snprintf(line + n, sizeof(line) - n, " %s=%lu", dhtStatusName((DhtStatus)s),
+                  (unsigned long)dhtAsyncCount((DhtStatus)s));
+  }
+  logWrite(LOG_INFO, line);
+}
+#else
+void readDht() {
+  TempAndHumidity th;
+  {
+    PROFILE_SCOPE(PROF_DHT);
+    th = dht.getTempAndHumidity();
+  }
+  applyDhtReading(th.temperature, th.humidity);
+}
+
+void dhtStepJob() {}
+#endif
+
+// --- Consome os batimentos registrados pela ISR ---
+void pollBeats() {
+  uint32_t t;
+  while (beatQueue.pop(t)) {
+    if (!beats.addBeat(t)) continue;
+    LOG_DEFER(LOG_DEBUG, "[BEAT] t_us=%lu ibi_us=%lu", (unsigned long)t, (unsigned long)beats.lastIbiUs());
+    if (!windowHasBeat) {
+      windowHasBeat = true;
+      windowFirstBeatUs = t;
+    }
+    uint32_t ibi = beats.lastIbiUs();
+    bool gap = ibi == 0 || ibi > (uint32_t)BPM_SLIDING_WINDOW_MS * 1000;
+    if (WINDOW_STATS) {
+      if (gap) windowStats.ibi.breakChain();
+      else windowStats.ibi.add(ibi);
+    }
+    alertBeat(ibi, gap, t);
+    if (!BPM_STREAM_ENABLED) continue;
+    if (gap) {
+      bpmFast.reset(); // primeiro batimento ou pausa longa: recomeça
+      continue;
+    }
+    bpmFast.addIbi(ibi);
+    if (!streamPending) {
+      streamPending = true;
+      streamPendingBeatUs = t;
+      sensingJobs.at(jobStream, streamLastEmitMs + BPM_STREAM_MIN_INTERVAL_MS);
     }
   }
 }
 
-// --- Calcula BPM ao fim de janela de 10s ---
-bool computeBpmIfWindowDone() {
+// --- Emite a estimativa rápida (job armado pelo primeiro batimento novo,
+// respeitando o intervalo mínimo desde a última emissão) ---
+void emitBpmStream() {
   uint32_t now = millis();
-  if (now - windowStart >= BPM_WINDOW_MS) {
-    noInterrupts();
-    uint32_t pulses = pulseCount;
-    pulseCount = 0; // reinicia para próxima janela
-    interrupts();
+  BpmUpdate u;
+  u.ts = now;
+  u.beatUs = streamPendingBeatUs;
+  u.bpmX10 = (uint16_t)lroundf(bpmFast.bpm() * 10.0f);
+  u.ibiMs = (uint16_t)(bpmFast.avgIbiUs() / 1000);
+  bpmUpdateQueue.push(u); // fila cheia: a próxima emissão leva o valor atual
+#if CARDIOIA_DUAL_CORE
+  networkWake.signal();
+#endif
+  streamPending = false;
+  streamLastEmitMs = now;
+}
 
-    lastBpm = (int)(pulses * 6); // 10s * 6 = 60s
-    windowStart = now;
-    return true;
+// --- Fecha a janela de 10s com o BPM estimado pelos intervalos ---
+// Job com cadência fixa: o atraso desta janela não empurra as seguintes e,
+// passando de uma janela inteira, a agenda ressincroniza.
+void closeWindow() {
+  lastBpm = (int)lroundf(beats.bpm(micros()));
+  if (lastBpm == 0) {
+    // Sem batimentos na janela: a taquicardia (se havia) normaliza
+    alertBeat(0, true, micros());
+    alertUpdate(ALERT_BPM, 0, micros());
+  }
+  if (windowHasBeat) {
+    latencyWindow.add((micros() - windowFirstBeatUs) / 1000);
+    windowHasBeat = false;
   }
-  return false;
-}
 
-// --- Monta JSON linha única ---
-String makeSampleJson(uint32_t ts, float temp, float hum, int bpm, bool connected) {
-  String s = "{";
-  s += "\"ts\":"; s += ts;
-  s += ",\"temp\":"; s += String(temp, 2);
-  s += ",\"hum\":"; s += String(hum, 2);
-  s += ",\"bpm\":"; s += bpm;
-  s += ",\"connected\":"; s += (connected ? "true" : "false");
-  s += "}";
-  return s;
+  uint32_t lateMs = sensingJobs.lateMs();
+  jitterWindows++;
+  jitterSumMs += lateMs;
+  if (lateMs > jitterMaxMs) jitterMaxMs = lateMs;
+
+  Sample sample = makeSample(millis(), lastTemp, lastHum, lastBpm, CONNECTED);
+  SampleRecord rec = WINDOW_STATS ? sampleRecord(sample, windowStats.close()) : sampleRecord(sample);
+  if (!sampleQueue.push(rec)) sampleQueueDrops++;
+#if CARDIOIA_DUAL_CORE
+  else networkWake.signal();   // no loop() único a rede roda logo em seguida
+#endif
 }
 
 // --- WiFi/MQTT helpers ---
@@ -180,71 +1272,220 @@ void mqttSetupIfNeeded() {
   }
   // Define sempre o servidor
   mqtt.setServer(MQTT_HOST, MQTT_PORT);
+#if DELIVERY_ACK
+  mqtt.setCallback(onMqttMessage);
+#endif
 }
 
-void mqttEnsureConnected() {
-  if (!CONNECTED) return;
-  if (WiFi.status() != WL_CONNECTED) return;
-  mqttSetupIfNeeded();
+void mqttConnectDone(bool ok) {
   unsigned long now = millis();
-  if (mqtt.connected()) return;
-  if (now < mqttNextRetry) return;
-
-  if (mqtt.connect(mqttClientId.c_str(), MQTT_USER, MQTT_PASS)) {
-    Serial.println(F("MQTT_CONNECTED"));
+  if (ok) {
+    logPrintf(LOG_INFO, "MQTT_CONNECTED ms=%lu", now - mqttConnectStartMs);
     mqttBackoffMs = 1000; // reset backoff
+#if DELIVERY_ACK
+    // Sessão limpa: reassina os acks e reenvia tudo que estava em voo
+    mqtt.subscribe(MQTT_TOPIC_ACK);
+    delivery.markUnsent();
+    ramBacklogSeal(delivery);
+#endif
+    networkJobs.atMost(jobMqttPoll, now, 0);
+    drainKick();
   } else {
-    Serial.println(F("MQTT_CONNECT_FAIL"));
+    logWrite(LOG_WARN, "MQTT_CONNECT_FAIL");
     // backoff exponencial com clamp a 30s
     unsigned long next = mqttBackoffMs * 2;
     if (next > 30000UL) next = 30000UL;
     mqttBackoffMs = next;
-    mqttNextRetry = now + mqttBackoffMs;
+    networkJobs.after(jobMqttRetry, now, mqttBackoffMs);
   }
 }
 
+void mqttConnectTask(void*) {
+  bool ok = mqtt.connect(mqttClientId.c_str(), MQTT_USER, MQTT_PASS);
+  mqttConnectState.store(ok ? MQTT_CONN_OK : MQTT_CONN_FAIL, std::memory_order_release);
+  networkWake.signal();
+  halEndTask();
+}
+
+// Máquina de estados: IDLE -> RUNNING (task) -> OK/FAIL -> IDLE. Nunca espera
+// pelo connect; o resultado é tratado na primeira chamada depois que sai.
+void mqttEnsureConnected() {
+  PROFILE_SCOPE(PROF_MQTT_CONNECT);
+  uint8_t state = mqttConnectState.load(std::memory_order_acquire);
+  if (state == MQTT_CONN_RUNNING) return;
+  if (state != MQTT_CONN_IDLE) {
+    mqttConnectState.store(MQTT_CONN_IDLE, std::memory_order_relaxed);
+    mqttConnectDone(state == MQTT_CONN_OK);
+    return;
+  }
+  if (!CONNECTED) return;
+  if (WiFi.status() != WL_CONNECTED) return;
+  mqttSetupIfNeeded();
+  if (mqtt.connected()) return;
+  if (networkJobs.armed(jobMqttRetry)) return;   // backoff: o job chama de novo
+
+  mqttConnectStartMs = millis();
+#if MQTT_CONNECT_ASYNC
+  mqttConnectState.store(MQTT_CONN_RUNNING, std::memory_order_release);
+  if (halStartTask(mqttConnectTask, "mqtt_connect", 8192, 1, NETWORK_CORE)) return;
+  mqttConnectState.store(MQTT_CONN_IDLE, std::memory_order_relaxed);
+#endif
+  mqttConnectDone(mqtt.connect(mqttClientId.c_str(), MQTT_USER, MQTT_PASS));
+}
+
 void mqttLoopIfConnected() {
-  if (mqtt.connected()) {
+  PROFILE_SCOPE(PROF_MQTT_LOOP);
+  if (mqttReady()) {
     mqtt.loop();
   }
 }
 
-void mqttPublishLineIfPossible(const String& line) {
-  if (!mqtt.connected()) return;
-  bool ok = mqtt.publish(MQTT_TOPIC, line.c_str());
-  if (ok) Serial.println(F("MQTT_PUBLISH_OK"));
-  else Serial.println(F("MQTT_PUBLISH_FAIL"));
+// Job de poll do MQTT: acks só chegam pelo mqtt.loop(), então com mensagens
+// em voo consulta a cada NET_POLL_MS; ocioso, só o keepalive. Com o link
+// caído acorda o laço para o mqttEnsureConnected() e para de consultar.
+void mqttPollJob() {
+  mqttLoopIfConnected();
+  if (!mqttReady()) {
+    networkWake.signal();
+    return;
+  }
+#if DELIVERY_ACK
+  uint32_t every = delivery.empty() ? MQTT_IDLE_POLL_MS : NET_POLL_MS;
+#else
+  uint32_t every = MQTT_IDLE_POLL_MS;
+#endif
+  networkJobs.after(jobMqttPoll, millis(), every);
+}
+
+// Devolve false se a amostra não ficou com o MQTT (vai para a fila)
+bool mqttPublishSampleIfPossible(const SampleRecord& rec, size_t jsonLen) {
+  if (!mqttReady()) return false;
+  size_t wire = 0;
+#if DELIVERY_ACK
+  // Na janela, a amostra é reenviada até o ack mesmo se este publish falhar
+  (void)jsonLen;
+  Delivery::Msg* m = delivery.push(&rec, 1, 0);
+  if (!m) return false;
+  ramBacklogSeal(delivery);
+  bool ok = deliverySend(*m, wire);
+  bool kept = true;
+#else
+  bool ok = mqttPublishSamples(&rec, 1, jsonLen, wire);
+  bool kept = ok;
+#endif
+  if (ok) logWrite(LOG_INFO, "MQTT_PUBLISH_OK");
+  else logWrite(LOG_WARN, "MQTT_PUBLISH_FAIL");
+  return kept;
+}
+
+// --- Comandos seriais ---
+// Linha acumulada sem bloqueio (serial_cmd.h) e despachada pela tabela
+// SERIAL_COMMANDS; para um comando novo basta um handler e uma linha nela.
+static const size_t SERIAL_LINE_MAX = 64;
+LineReader<SERIAL_LINE_MAX> serialLine;
+
+void cmdOnline(const char*) {
+  CONNECTED = true;
+  logWrite(LOG_INFO, "[STATE] CONNECTED=true (ONLINE)");
+  // Tenta conectar WiFi/MQTT (TLS); o backlog sai aos poucos em ramDrainStep()
+  ensureWifiIfConnected();
+  mqttEnsureConnected();
+  drainKick();
+}
+
+void cmdOffline(const char*) {
+  CONNECTED = false;
+  logWrite(LOG_INFO, "[STATE] CONNECTED=false (OFFLINE)");
+}
+
+void cmdStats(const char* args) {
+#if CARDIOIA_PROFILE
+  if (strcasecmp(args, "RESET") == 0) {
+    profileReset();
+    logWrite(LOG_INFO, "[STATS] zerado");
+  } else {
+    profilePrint();
+  }
+#else
+  (void)args;
+  logWrite(LOG_INFO, "[STATS] profiling desligado (CARDIOIA_PROFILE 0)");
+#endif
+}
+
+// LOG <ERROR|WARN|INFO|DEBUG> muda o nível; sem argumento mostra o atual
+void cmdLog(const char* args) {
+  LogLevel level;
+  if (*args && !logParseLevel(args, level)) {
+    logPrintf(LOG_WARN, "[WARN] Nível de log desconhecido: %s", args);
+    return;
+  }
+  if (*args) logSetLevel(level);
+  logPrintf(LOG_ERROR, "[LOG] nivel=%s perdidas=%lu",
+            logLevelName((LogLevel)logCurrentLevel), (unsigned long)logDropped());
+}
+
+// ALERT mostra limiares e estado; ALERT <TEMP|BPM> <dispara> <normaliza>
+// muda a regra (°C ou bpm; normaliza <= dispara)
+void cmdAlert(const char* args) {
+  char rule[8];
+  float fire, clear;
+  if (*args) {
+    uint8_t r = ALERT_RULE_COUNT;
+    int n = sscanf(args, "%7s %f %f", rule, &fire, &clear);
+    if (n == 3 && strcasecmp(rule, "TEMP") == 0) r = ALERT_TEMP;
+    if (n == 3 && strcasecmp(rule, "BPM") == 0) r = ALERT_BPM;
+    float scale = r == ALERT_TEMP ? 100.0f : 10.0f;
+    if (r == ALERT_RULE_COUNT ||
+        !alertEngine.configure(r, (int32_t)lroundf(fire * scale), (int32_t)lroundf(clear * scale))) {
+      logPrintf(LOG_WARN, "[WARN] Uso: ALERT <TEMP|BPM> <dispara> <normaliza>: %s", args);
+      return;
+    }
+  }
+  logPrintf(LOG_ERROR, "[ALERT] temp>%.2f normaliza<=%.2f bpm>%.1f normaliza<=%.1f status=%s",
+            alertEngine.fireAbove(ALERT_TEMP) / 100.0, alertEngine.clearAtOrBelow(ALERT_TEMP) / 100.0,
+            alertEngine.fireAbove(ALERT_BPM) / 10.0, alertEngine.clearAtOrBelow(ALERT_BPM) / 10.0,
+            alertStatusName(alertEngine.status()));
+}
+
+void cmdHelp(const char*);
+
+static const SerialCommand SERIAL_COMMANDS[] = {
+  {"ONLINE",  cmdOnline,  "conecta WiFi/MQTT e publica"},
+  {"OFFLINE", cmdOffline, "enfileira localmente"},
+  {"STATS",   cmdStats,   "profiling por etapa (STATS RESET zera)"},
+  {"LOG",     cmdLog,     "nível do log serial (LOG DEBUG|INFO|WARN|ERROR)"},
+  {"ALERT",   cmdAlert,   "limiares de alerta (ALERT TEMP 38 37.8 | ALERT BPM 120 115)"},
+  {"HELP",    cmdHelp,    "lista os comandos"},
+};
+static const size_t SERIAL_COMMAND_COUNT = sizeof(SERIAL_COMMANDS) / sizeof(SERIAL_COMMANDS[0]);
+
+void cmdHelp(const char*) {
+  for (size_t i = 0; i < SERIAL_COMMAND_COUNT; i++) {
+    logPrintf(LOG_INFO, "[HELP] %s - %s", SERIAL_COMMANDS[i].name, SERIAL_COMMANDS[i].help);
+  }
 }
 
-// --- Processa comandos seriais ---
 void handleSerialCommands() {
-  while (Serial.available()) {
-    String cmd = Serial.readStringUntil('\n');
-    cmd.trim();
-    if (cmd.equalsIgnoreCase("ONLINE")) {
-      CONNECTED = true;
-      Serial.println(F("[STATE] CONNECTED=true (ONLINE)"));
-      // Tenta conectar WiFi/MQTT (TLS)
-      ensureWifiIfConnected();
-      mqttEnsureConnected();
-      // Tenta flush do buffer em RAM, se já conectado
-      if (mqtt.connected()) {
-        ramFlushPublish();
-      }
-    } else if (cmd.equalsIgnoreCase("OFFLINE")) {
-      CONNECTED = false;
-      Serial.println(F("[STATE] CONNECTED=false (OFFLINE)"));
-    } else if (cmd.length() > 0) {
-      Serial.print(F("[WARN] Unknown command: ")); Serial.println(cmd);
+  PROFILE_SCOPE(PROF_SERIAL);
+  while (serialLine.poll(Serial)) {
+    if (!dispatchCommand(SERIAL_COMMANDS, SERIAL_COMMAND_COUNT, serialLine.line())) {
+      logPrintf(LOG_WARN, "[WARN] Unknown command: %s", serialLine.line());
     }
   }
+  if (serialLine.takeOverflow()) {
+    logPrintf(LOG_WARN, "[WARN] Linha maior que %lu bytes descartada", (unsigned long)(SERIAL_LINE_MAX - 1));
+  }
 }
+void onSerialReceive() { networkWake.signal(); }
+
 void setup() {
+  bootMs = millis();
   Serial.begin(115200);
+  halOnSerialReceive(onSerialReceive);
   delay(200);
-  Serial.println(F("Booting..."));
-  Serial.println(F("Digite ONLINE no Serial para conectar WiFi+MQTT (TLS)."));
-  Serial.println(F("Clique rápido no botão (GPIO4) para aumentar BPM; ajuste o DHT22 > 38 °C para alerta."));
+  logWrite(LOG_INFO, "Booting...");
+  logWrite(LOG_INFO, "Digite ONLINE no Serial para conectar WiFi+MQTT (TLS).");
+  logWrite(LOG_INFO, "Clique rápido no botão (GPIO4) para aumentar BPM; ajuste o DHT22 > 38 °C para alerta.");
 
   // Pinos
   pinMode(PIN_BTN, INPUT); // botão com pull-down externo
@@ -252,16 +1493,267 @@ void setup() {
   attachInterrupt(digitalPinToInterrupt(PIN_BTN), onButtonChange, CHANGE);
 
   // DHT
+#if DHT_ASYNC
+  dhtAsyncBegin(PIN_DHT);
+#else
   dht.setup(PIN_DHT, DHTesp::DHT22);
+#endif
 
-  // Tempos
-  windowStart = millis();
+  // Backlog em RAM de antes do reset, antes de tocar na flash
+  ramBacklogRestore();
+
+  // Log persistente em flash: recupera backlog de antes do reboot
+  if (halFsBegin() && flashLog.begin()) {
+#if DELIVERY_ACK
+    // As primeiras depois da posição gravada são as da janela retida
+    Sample skip;
+    for (size_t n = delivery.flashSamples(); n > 0 && flashLog.peek(skip); n--) flashLog.pop();
+#endif
+    logPrintf(LOG_INFO, "FLASH_LOG recovered=%lu", (unsigned long)flashLog.size());
+  } else {
+    logWrite(LOG_WARN, "[WARN] FLASH_LOG indisponível (apenas RAM)");
+  }
+  size_t ramBytes = sizeof(ramBacklog), blockBytes = 0, aggs = 0;
+#if RAM_BLOCKS
+  blockBytes = ramBlocks.capacityBytes();
+#endif
+#if RAM_COMPACT
+  aggs = compactor.capacity();
+#endif
+  logPrintf(LOG_INFO, "RAM_QUEUE janelas=%lu blocos_bytes=%lu agregados=%lu bytes=%lu",
+            (unsigned long)ramQueue.capacity(), (unsigned long)blockBytes, (unsigned long)aggs,
+            (unsigned long)ramBytes);
+
+  // Prazos: a cadência do DHT conta do boot, a das janelas (e do relatório,
+  // que sai junto da 6ª) de agora
+  uint32_t now = millis();
+  jobDht = sensingJobs.add(readDht, DHT_INTERVAL_MS);
+  jobDhtStep = sensingJobs.add(dhtStepJob);
+  jobWindow = sensingJobs.add(closeWindow, BPM_WINDOW_MS);
+  jobStream = sensingJobs.add(emitBpmStream);
+  sensingJobs.at(jobDht, bootMs + DHT_INTERVAL_MS);
+  sensingJobs.at(jobWindow, now + BPM_WINDOW_MS);
+  jobMqttPoll = networkJobs.add(mqttPollJob);
+  jobMqttRetry = networkJobs.add(mqttEnsureConnected);
+  jobDrain = networkJobs.add(drainJob);
+  jobStats = networkJobs.add(printJitterReport, STATS_REPORT_MS);
+  networkJobs.at(jobStats, now + STATS_REPORT_MS);
+#if CARDIOIA_PROFILE && PROFILE_TELEMETRY_MS > 0
+  jobProfile = networkJobs.add(profilePublishJob, PROFILE_TELEMETRY_MS);
+  networkJobs.after(jobProfile, now, PROFILE_TELEMETRY_MS);
+#endif
+
+#if DELIVERY_ACK
+  deliveryBoot = halRandom();
+#endif
 
   // TLS sem verificação de certificado (demo). Em produção, configure a CA.
   tlsClient.setInsecure();
+  tlsClient.setHandshakeTimeout(MQTT_CONNECT_TIMEOUT_S);
+  mqtt.setSocketTimeout(MQTT_CONNECT_TIMEOUT_S);
+
+#if CARDIOIA_DUAL_CORE
+  halStartTask(sensingTask, "sensing", 4096, 2, SENSING_CORE);
+  halStartTask(networkTask, "network", 8192, 1, NETWORK_CORE);
+  halStartTask(logTask, "log", 3072, 0, NETWORK_CORE);
+#endif
 }
 
-void loop() {
+// --- Etapa de sensoriamento ---
+// DHT e janela de BPM; a amostra fechada vai para a fila da rede.
+void sensingStep() {
+  pollBeats();
+  sensingJobs.runDue(millis());
+}
+
+// Acordadas e fração do tempo acordado desde o último relatório
+void printDutyReport(const char* name, DutyCycle& d) {
+  uint32_t now = micros();
+  uint32_t wakeups = d.wakeups, slept = d.sleptUs;
+  uint32_t elapsed = now - d.reportedAtUs;
+  uint32_t sleptDelta = slept - d.reportedSleptUs;
+  double busyPct = elapsed ? 100.0 * (elapsed - (sleptDelta < elapsed ? sleptDelta : elapsed)) / elapsed : 0.0;
+  logPrintf(LOG_INFO, "[SLEEP] %s acordadas=%lu ocupado_pct=%.2f", name,
+            (unsigned long)(wakeups - d.reportedWakeups), busyPct);
+  d.reportedWakeups = wakeups;
+  d.reportedSleptUs = slept;
+  d.reportedAtUs = now;
+}
+
+void printJitterReport() {
+  uint32_t windows = jitterWindows;
+  logPrintf(LOG_INFO, "[JITTER] janelas=%lu atraso_max_ms=%lu atraso_medio_ms=%.1f drops=%lu",
+            (unsigned long)windows, (unsigned long)jitterMaxMs,
+            windows ? (double)jitterSumMs / windows : 0.0, (unsigned long)sampleQueueDrops);
+  char line[LOG_LINE_MAX];
+  int n = snprintf(line, sizeof(line), "[LATENCY] janela_media_ms=%.0f janela_max_ms=%lu",
+                   latencyWindow.count ? (double)latencyWindow.sumMs / latencyWindow.count : 0.0,
+                   (unsigned long)latencyWindow.maxMs);
+  if (BPM_STREAM_ENABLED && n > 0 && (size_t)n < sizeof(line)) {
+    snprintf(line + n, sizeof(line) - n, " stream_media_ms=%.0f stream_max_ms=%lu stream_msgs=%lu",
+             latencyStream.count ? (double)latencyStream.sumMs / latencyStream.count : 0.0,
+             (unsigned long)latencyStream.maxMs, (unsigned long)latencyStream.count);
+  }
+  logWrite(LOG_INFO, line);
+  if (ALERT_ENGINE && (alertEngine.transitions() || alertQueueDrops)) {
+    logPrintf(LOG_INFO, "[ALERT] status=%s transicoes=%lu publicados=%lu latencia_media_ms=%.0f latencia_max_ms=%lu "
+              "descartados=%lu",
+              alertStatusName(alertEngine.status()), (unsigned long)alertEngine.transitions(),
+              (unsigned long)latencyAlert.count,
+              latencyAlert.count ? (double)latencyAlert.sumMs / latencyAlert.count : 0.0,
+              (unsigned long)latencyAlert.maxMs, (unsigned long)alertQueueDrops);
+  }
+  logPrintf(LOG_INFO, "[LOOP] iter_p50_us=%lu iter_p99_us=%lu iter_max_us=%lu acima_orcamento=%lu orcamento_ms=%lu",
+            (unsigned long)loopHist.percentile(50), (unsigned long)loopHist.percentile(99),
+            (unsigned long)loopHist.max(), (unsigned long)loopOverBudget, (unsigned long)LOOP_BUDGET_MS);
+  loopHist.reset();
+  loopOverBudget = 0;
+#if DHT_ASYNC
+  printDhtReport();
+#endif
+#if CARDIOIA_DUAL_CORE
+  printDutyReport("sensoriamento", sensingDuty);
+  printDutyReport("rede", networkDuty);
+#else
+  printDutyReport("loop", networkDuty);
+#endif
+}
+
+// --- Publica as transições de alerta ---
+// Antes de qualquer amostra: {"ts","rule","active","value","status"}, com
+// value em °C ou bpm. OFFLINE, sem MQTT (ou com falha) a transição fica na
+// fila e sai primeiro na próxima vez.
+void publishAlerts() {
+  AlertEvent ev;
+  while (alertQueue.peek(ev)) {
+    if (!CONNECTED || !mqttReady()) return;
+    char buf[112];
+    char value[16];
+    if (ev.rule == ALERT_TEMP) snprintf(value, sizeof(value), "%.2f", ev.value / 100.0);
+    else snprintf(value, sizeof(value), "%.1f", ev.value / 10.0);
+    int len = snprintf(buf, sizeof(buf), "{\"ts\":%lu,\"rule\":\"%s\",\"active\":%s,\"value\":%s,\"status\":\"%s\"}",
+                       (unsigned long)ev.ts, alertRuleName(ev.rule), ev.active ? "true" : "false", value,
+                       alertStatusName(ev.status));
+    if (!mqtt.publish(MQTT_TOPIC_ALERT, (const uint8_t*)buf, len, false)) return;
+    alertQueue.pop(ev);
+    uint32_t ms = (micros() - ev.eventUs) / 1000;
+    latencyAlert.add(ms);
+    logPrintf(LOG_INFO, "ALERT_PUBLISH regra=%s ativo=%d status=%s latencia_ms=%lu", alertRuleName(ev.rule),
+              ev.active ? 1 : 0, alertStatusName(ev.status), (unsigned long)ms);
+  }
+}
+
+// --- Publica as atualizações de BPM em streaming ---
+// Sem conexão, as atualizações são descartadas: só a mais recente importa.
+void publishBpmUpdates() {
+  BpmUpdate u;
+  while (bpmUpdateQueue.pop(u)) {
+    if (!CONNECTED || !mqttReady()) continue;
+    char buf[64];
+    int len = snprintf(buf, sizeof(buf), "{\"ts\":%lu,\"bpm\":%u.%u,\"ibi\":%u}",
+                       (unsigned long)u.ts, u.bpmX10 / 10, u.bpmX10 % 10, u.ibiMs);
+    if (mqtt.publish(MQTT_TOPIC_BPM, (const uint8_t*)buf, len, false)) {
+      latencyStream.add((micros() - u.beatUs) / 1000);
+    }
+  }
+}
+
+// Resumo da janela no Serial (o JSON completo passa do tamanho da linha)
+void logWindowStats(const SampleStats& st) {
+  logPrintf(LOG_DEBUG, "[VITALS] dht_n=%u temp_sd=%u hum_sd=%u ibi_n=%u sdnn=%u rmssd=%u", st.dhtN, st.tempSd,
+            st.humSd, st.ibiN, st.sdnn, st.rmssd);
+}
+
+// --- Publica ou enfileira uma amostra fechada ---
+// Só a janela ao vivo leva o resumo; no backlog vai a Sample
+void processSample(const SampleRecord& rec) {
+  Sample sample = recordSample(rec);
+  if (CONNECTED) {
+    char json[RECORD_JSON_MAX];
+    size_t jsonLen;
+    {
+      PROFILE_SCOPE(PROF_JSON);
+      jsonLen = formatRecordJson(json, sizeof(json), rec);
+    }
+    // Publica diretamente na nuvem (MQTT) e loga no Serial
+    logPrintf(LOG_INFO, "BPM janela= %d", (int)sample.bpm);
+    if (recordHasStats(rec)) {
+      formatSampleJson(json, sizeof(json), sample);
+      logWindowStats(rec.stats);
+    }
+    logWrite(LOG_INFO, json);
+    // Ao vivo sai antes do backlog; sem MQTT (ou com falha) vai para a fila
+    if (!mqttPublishSampleIfPossible(rec, jsonLen)) {
+      ramEnqueue(sample);
+      drainKick();
+    }
+  } else {
+    // Offline: enfileira em RAM
+    ramEnqueue(sample);
+    drainKick();
+    logPrintf(LOG_INFO, "BPM janela= %d", (int)sample.bpm);
+    logPrintf(LOG_INFO, "[OFFLINE] queued RAM size=%lu FLASH size=%lu alertas=%lu",
+              (unsigned long)ramQueue.size(), (unsigned long)flashLog.size(),
+              (unsigned long)ramQueue.alerts());
+#if RAM_BLOCKS
+    if (ramBlocks.size() > 0) {
+      logPrintf(LOG_INFO, "[OFFLINE] blocos=%lu amostras=%lu bytes=%lu", (unsigned long)ramBlocks.blocks(),
+                (unsigned long)ramBlocks.size(), (unsigned long)ramBlocks.bytesUsed());
+    }
+#endif
+#if RAM_COMPACT
+    if (compactor.size() > 0) {
+      logPrintf(LOG_INFO, "[OFFLINE] compactado agregados=%lu janelas=%lu descartadas=%lu",
+                (unsigned long)compactor.size(), (unsigned long)compactor.windows(),
+                (unsigned long)compactor.dropped());
+    }
+#endif
+  }
+}
+
+// --- Telemetria de profiling ---
+#if CARDIOIA_PROFILE && PROFILE_TELEMETRY_MS > 0
+static const char* MQTT_TOPIC_PROF = "cardioia/ana/v1/telemetry/prof";
+
+void profilePublishJob() {
+  if (!mqttReady()) return;
+  uint32_t now = millis();
+  char buf[768];
+  size_t len = profileFormatJson(buf, sizeof(buf), now);
+  if (len == 0 || !mqtt.beginPublish(MQTT_TOPIC_PROF, len, false)) return;
+  if (mqtt.write((const uint8_t*)buf, len) != len) {
+    tlsClient.stop();
+    return;
+  }
+  mqtt.endPublish();
+}
+#endif
+
+// --- Próximos prazos ---
+// Quanto cada laço pode dormir sem perder nada (0 = tem trabalho agora)
+uint32_t sensingWaitMs() {
+  if (beatQueue.size() > 0) return 0;
+  return sensingJobs.nextDueIn(millis());
+}
+
+uint32_t networkWaitMs() {
+  if (sampleQueue.size() > 0 || bpmUpdateQueue.size() > 0) return 0;
+  if (alertQueue.size() > 0 && CONNECTED && mqttReady()) return 0;
+  uint8_t state = mqttConnectState.load(std::memory_order_acquire);
+  if (state == MQTT_CONN_OK || state == MQTT_CONN_FAIL) return 0;
+  uint32_t wait = networkJobs.nextDueIn(millis());
+  // WiFi subindo não avisa: consulta
+  if (CONNECTED && state == MQTT_CONN_IDLE && WiFi.status() != WL_CONNECTED && NET_POLL_MS < wait) {
+    wait = NET_POLL_MS;
+  }
+  return wait;
+}
+
+// --- Etapa de rede ---
+// Serial, WiFi/MQTT e consumo das amostras vindas do sensoriamento; depois
+// os prazos vencidos (poll e retry do MQTT, drain do backlog depois das
+// amostras ao vivo, relatórios).
+void networkStep() {
   handleSerialCommands();
 
   // Conectividade (modo conectado)
@@ -269,31 +1761,59 @@ void loop() {
     ensureWifiIfConnected();
     mqttEnsureConnected();
   }
-  mqttLoopIfConnected();
 
-  // Leituras periódicas
-  readDhtIfDue();
-
-  // Verifica janela de BPM
-  bool windowDone = computeBpmIfWindowDone();
-  if (windowDone) {
-    uint32_t ts = millis();
-    String json = makeSampleJson(ts, lastTemp, lastHum, lastBpm, CONNECTED);
-
-    if (CONNECTED) {
-      // Publica diretamente na nuvem (MQTT) e loga no Serial
-      Serial.print(F("BPM janela= ")); Serial.println(lastBpm);
-      Serial.println(json);
-      // Primeiro tenta limpar backlog em RAM
-      if (mqtt.connected()) {
-        ramFlushPublish();
-      }
-      mqttPublishLineIfPossible(json);
-    } else {
-      // Offline: enfileira em RAM
-      ramEnqueue(json);
-      Serial.print(F("BPM janela= ")); Serial.println(lastBpm);
-      Serial.print(F("[OFFLINE] queued RAM size=")); Serial.println((unsigned long)ramCount);
-    }
+  if (ALERT_ENGINE) publishAlerts();
+  if (BPM_STREAM_ENABLED) publishBpmUpdates();
+
+  SampleRecord rec;
+  while (sampleQueue.pop(rec)) {
+    processSample(rec);
+  }
+
+  networkJobs.runDue(millis());
+}
+
+#if CARDIOIA_DUAL_CORE
+void sensingTask(void*) {
+  for (;;) {
+    sensingStep();
+    sleepUntilEvent(sensingWake, sensingDuty, sensingWaitMs());
   }
 }
+
+void networkTask(void*) {
+  for (;;) {
+    uint32_t t0 = micros();
+    networkStep();
+    loopIterDone(micros() - t0);
+    sleepUntilEvent(networkWake, networkDuty, networkWaitMs());
+  }
+}
+
+// Esvazia o log no UART abaixo das outras tasks; dorme até uma linha nova
+void logTask(void*) {
+  for (;;) {
+    logDrain();
+    logWait(logPending() ? LOG_DRAIN_POLL_MS : LOOP_MAX_SLEEP_MS);
+  }
+}
+#endif
+
+void loop() {
+#if CARDIOIA_DUAL_CORE
+  // As tarefas criadas no setup() assumem o trabalho
+  vTaskDelete(NULL);
+#else
+  uint32_t t0 = micros();
+  sensingStep();
+  networkStep();
+  loopIterDone(micros() - t0);
+  // Fora do tempo medido: só escreve o que cabe no FIFO do UART
+  logDrain();
+  uint32_t wait = sensingWaitMs();
+  uint32_t net = networkWaitMs();
+  if (net < wait) wait = net;
+  if (logPending() && LOG_DRAIN_POLL_MS < wait) wait = LOG_DRAIN_POLL_MS;
+  sleepUntilEvent(sensingWake, networkDuty, wait);
+#endif
+}
@@ -0,0 +1,61 @@
+#include "profile.h"
+
+#if CARDIOIA_PROFILE
+
+#include <stdio.h>
+#include "log.h"
+
+LatencyHist profileHist[PROF_STAGES];
+
+static const char* const PROFILE_NAMES[PROF_STAGES] = {
+  "serial", "mqtt_connect", "mqtt_loop", "dht", "json", "publish", "drain",
+};
+
+// Ciclos -> µs com uma casa decimal (em décimos)
+static unsigned long cyclesToUsX10(uint32_t cycles) {
+  return (unsigned long)((uint64_t)cycles * 10 / halCpuMhz());
+}
+
+void profilePrint() {
+  logPrintf(LOG_INFO, "[STATS] cpu_mhz=%lu", (unsigned long)halCpuMhz());
+  for (uint8_t i = 0; i < PROF_STAGES; i++) {
+    const LatencyHist& h = profileHist[i];
+    char line[160];
+    unsigned long p50 = cyclesToUsX10(h.percentile(50));
+    unsigned long p99 = cyclesToUsX10(h.percentile(99));
+    unsigned long max = cyclesToUsX10(h.max());
+    snprintf(line, sizeof(line), "[STATS] %-12s n=%lu p50_us=%lu.%lu p99_us=%lu.%lu max_us=%lu.%lu",
+             PROFILE_NAMES[i], (unsigned long)h.count(),
+             p50 / 10, p50 % 10, p99 / 10, p99 % 10, max / 10, max % 10);
+    logWrite(LOG_INFO, line);
+  }
+}
+
+// {"ts":..,"cpu_mhz":..,"stages":{"dht":{"n":..,"p50":..,"p99":..,"max":..},...}}
+// com tempos em ciclos (o consumidor divide por cpu_mhz)
+size_t profileFormatJson(char* out, size_t cap, uint32_t ts) {
+  int n = snprintf(out, cap, "{\"ts\":%lu,\"cpu_mhz\":%lu,\"stages\":{",
+                   (unsigned long)ts, (unsigned long)halCpuMhz());
+  if (n < 0 || (size_t)n >= cap) return 0;
+  size_t used = n;
+  for (uint8_t i = 0; i < PROF_STAGES; i++) {
+    const LatencyHist& h = profileHist[i];
+    n = snprintf(out + used, cap - used, "%s\"%s\":{\"n\":%lu,\"p50\":%lu,\"p99\":%lu,\"max\":%lu}",
+                 i ? "," : "", PROFILE_NAMES[i], (unsigned long)h.count(),
+                 (unsigned long)h.percentile(50), (unsigned long)h.percentile(99),
+                 (unsigned long)h.max());
+    if (n < 0 || (size_t)n >= cap - used) return 0;
+    used += n;
+  }
+  if (cap - used < 3) return 0;
+  out[used++] = '}';
+  out[used++] = '}';
+  out[used] = '\0';
+  return used;
+}
+
+void profileReset() {
+  for (uint8_t i = 0; i < PROF_STAGES; i++) profileHist[i].reset();
+}
+
+#endif
@@ -0,0 +1,60 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// --- Profiling por etapa do loop ---
+// Cada etapa instrumentada mede sua duração pelo contador de ciclos da CPU
+// (halCycleCount(), poucas instruções) e soma num histograma log2 fixo
+// (latency_hist.h). O comando STATS imprime p50/p99/max por etapa e, com
+// PROFILE_TELEMETRY_MS > 0, o mesmo resumo sai periodicamente em JSON no
+// tópico de telemetria. Com CARDIOIA_PROFILE 0 (env de release) nada disso
+// é compilado: PROFILE_SCOPE() vira um statement vazio.
+//
+// Cada etapa é medida por uma única task (DHT no sensoriamento, o resto na
+// rede); a leitura pelo STATS pode pegar um histograma no meio de um add(),
+// o que só desloca uma contagem.
+#ifndef CARDIOIA_PROFILE
+#define CARDIOIA_PROFILE 1
+#endif
+
+enum ProfileStage : uint8_t {
+  PROF_SERIAL,        // handleSerialCommands()
+  PROF_MQTT_CONNECT,  // mqttEnsureConnected()
+  PROF_MQTT_LOOP,     // mqttLoopIfConnected()
+  PROF_DHT,           // leitura do DHT (cada passo, no modo assíncrono)
+  PROF_JSON,          // serialização da amostra ao vivo
+  PROF_PUBLISH,       // mqttPublishSamples()
+  PROF_DRAIN,         // ramDrainStep()
+  PROF_STAGES
+};
+
+#if CARDIOIA_PROFILE
+
+#include "hal.h"
+#include "latency_hist.h"
+
+extern LatencyHist profileHist[PROF_STAGES];
+
+class ProfileScope {
+public:
+  explicit ProfileScope(ProfileStage stage) : stage_(stage), start_(halCycleCount()) {}
+  ~ProfileScope() { profileHist[stage_].add(halCycleCount() - start_); }
+
+private:
+  ProfileStage stage_;
+  uint32_t start_;
+};
+
+#define PROFILE_SCOPE(stage) ProfileScope profileScope_(stage)
+
+// Resumo legível (comando STATS)
+void profilePrint();
+// Resumo em JSON; devolve o tamanho (0 se não coube)
+size_t profileFormatJson(char* out, size_t cap, uint32_t ts);
+void profileReset();
+
+#else
+
+#define PROFILE_SCOPE(stage) do {} while (0)
+
+#endif
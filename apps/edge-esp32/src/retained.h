@@ -0,0 +1,103 @@
+#pragma once
+#include <new>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "hal.h"
+
+// --- Estado retido entre resets (memória HAL_NOINIT) ---
+// Um T guardado em bytes crus, que o boot não zera, atrás de um cabeçalho
+// com magic, versão, tamanho e dois CRC-32: o do cabeçalho e o do T. O tipo
+// precisa de construtor trivial (bytes crus) para não ser zerado pela
+// inicialização estática; T em si é construído só em reset() e precisa ser
+// copiável byte a byte (sem ponteiros para fora dele).
+//
+// restore() no boot diz se o conteúdo é de um boot anterior e íntegro;
+// seal() depois de cada mudança recalcula o CRC. Um reset no meio de uma
+// mudança deixa o CRC velho: o restore seguinte descarta tudo em vez de
+// usar um estado pela metade. Quem muda o estado sela antes de qualquer
+// operação demorada (rede, flash), para essa janela ficar curta.
+//
+// O CRC do T é por segmento de SEGMENT bytes, numa tabela coberta pelo CRC
+// do cabeçalho: seal(p, n) recalcula só os segmentos de [p, p + n), então
+// selar uma parte pequena de um T grande custa a parte, não o T.
+enum RetainStatus : uint8_t {
+  RETAIN_OK,
+  RETAIN_EMPTY,        // sem magic: power-on ou outro conteúdo
+  RETAIN_BAD_HEADER,   // cabeçalho corrompido ou gravado pela metade
+  RETAIN_BAD_LAYOUT,   // outra versão/configuração do firmware
+  RETAIN_BAD_CRC,      // dados alterados depois do último seal()
+  RETAIN_BAD_STATE,    // íntegro, mas inconsistente (checado por quem usa)
+  RETAIN_STATUS_COUNT
+};
+
+inline const char* retainStatusName(RetainStatus s) {
+  static const char* const names[RETAIN_STATUS_COUNT] = {"ok", "vazio", "cabecalho", "layout", "crc",
+                                                       "estado"};
+  return s < RETAIN_STATUS_COUNT ? names[s] : "?";
+}
+
+template <typename T, uint16_t VERSION, size_t SEGMENT = 512>
+class Retained {
+public:
+  static const uint32_t MAGIC = 0x43524E31;   // "CRN1"
+  static const size_t SEGMENTS = (sizeof(T) + SEGMENT - 1) / SEGMENT;
+  static_assert(SEGMENT > 0 && SEGMENT <= 0xFFFF, "segmento fora do cabeçalho");
+
+  T& get() { return *reinterpret_cast<T*>(raw_); }
+
+  RetainStatus restore() const {
+    if (hdr_.magic != MAGIC) return RETAIN_EMPTY;
+    if (hdr_.headerCrc != halCrc32(&hdr_, offsetof(Header, headerCrc))) return RETAIN_BAD_HEADER;
+    if (hdr_.version != VERSION || hdr_.segment != SEGMENT || hdr_.size != sizeof(T)) return RETAIN_BAD_LAYOUT;
+    if (hdr_.tableCrc != halCrc32(crc_, sizeof(crc_))) return RETAIN_BAD_CRC;
+    for (size_t i = 0; i < SEGMENTS; i++) {
+      if (crc_[i] != segmentCrc(i)) return RETAIN_BAD_CRC;
+    }
+    return RETAIN_OK;
+  }
+
+  // Constrói um T novo (descarta o conteúdo) e sela
+  template <typename... Args>
+  void reset(Args... args) {
+    hdr_.magic = 0;
+    new (raw_) T(args...);
+    seal();
+  }
+
+  void seal() { seal(raw_, sizeof(T)); }
+
+  // Sela só os segmentos que cobrem [p, p + n), uma parte de get()
+  void seal(const void* p, size_t n) {
+    size_t off = (size_t)(static_cast<const uint8_t*>(p) - raw_);
+    if (n == 0 || off >= sizeof(T)) return;
+    if (n > sizeof(T) - off) n = sizeof(T) - off;
+    for (size_t i = off / SEGMENT; i <= (off + n - 1) / SEGMENT; i++) crc_[i] = segmentCrc(i);
+    hdr_.magic = MAGIC;
+    hdr_.version = VERSION;
+    hdr_.segment = (uint16_t)SEGMENT;
+    hdr_.size = sizeof(T);
+    hdr_.tableCrc = halCrc32(crc_, sizeof(crc_));
+    hdr_.headerCrc = halCrc32(&hdr_, offsetof(Header, headerCrc));
+  }
+
+private:
+  struct Header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t segment;     // SEGMENT
+    uint32_t size;
+    uint32_t tableCrc;    // de crc_
+    uint32_t headerCrc;   // dos campos acima
+  };
+
+  uint32_t segmentCrc(size_t i) const {
+    size_t off = i * SEGMENT;
+    size_t n = sizeof(T) - off < SEGMENT ? sizeof(T) - off : SEGMENT;
+    return halCrc32(raw_ + off, n);
+  }
+
+  Header hdr_;
+  uint32_t crc_[SEGMENTS];
+  alignas(T) uint8_t raw_[sizeof(T)];
+};
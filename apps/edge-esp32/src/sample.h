@@ -0,0 +1,59 @@
+#pragma once
+#include <stdint.h>
+#include <math.h>
+
+// --- Amostra binária (POD) ---
+// Registro compacto de uma janela: 11 bytes, sem heap. O JSON só é montado
+// na hora de publicar. temp/hum em ponto fixo (centésimos), o que preserva
+// exatamente as 2 casas decimais do formato de saída. O arredondamento é o
+// do "%.2f" (valor binário exato, empate para o par): float * 100 é exato em
+// double, então rint() acerta até os empates (0.125f -> 12).
+
+// Flags da amostra
+static const uint8_t SAMPLE_F_CONNECTED = 0x01;  // estado CONNECTED na janela
+static const uint8_t SAMPLE_F_TEMP_NAN  = 0x02;  // sem leitura válida de temp
+static const uint8_t SAMPLE_F_HUM_NAN   = 0x04;  // sem leitura válida de hum
+
+struct __attribute__((packed)) Sample {
+  uint32_t ts;     // millis() no fechamento da janela
+  int16_t  temp;   // °C * 100
+  uint16_t hum;    // % * 100
+  uint16_t bpm;
+  uint8_t  flags;  // SAMPLE_F_*
+};
+
+static_assert(sizeof(Sample) == 11, "Sample deve ser empacotada (11 bytes)");
+
+inline Sample makeSample(uint32_t ts, float temp, float hum, int bpm, bool connected) {
+  Sample s;
+  s.ts = ts;
+  s.flags = connected ? SAMPLE_F_CONNECTED : 0;
+  if (isnan(temp)) { s.temp = 0; s.flags |= SAMPLE_F_TEMP_NAN; }
+  else s.temp = (int16_t)rint((double)temp * 100.0);
+  if (isnan(hum)) { s.hum = 0; s.flags |= SAMPLE_F_HUM_NAN; }
+  else s.hum = (uint16_t)rint((double)hum * 100.0);
+  s.bpm = (uint16_t)(bpm < 0 ? 0 : bpm);
+  return s;
+}
+
+inline float sampleTemp(const Sample& s) {
+  return (s.flags & SAMPLE_F_TEMP_NAN) ? NAN : s.temp / 100.0f;
+}
+
+inline float sampleHum(const Sample& s) {
+  return (s.flags & SAMPLE_F_HUM_NAN) ? NAN : s.hum / 100.0f;
+}
+
+inline bool sampleConnected(const Sample& s) {
+  return (s.flags & SAMPLE_F_CONNECTED) != 0;
+}
+
+// Alerta: mesmos limiares do fn_norm no Node-RED (temp > 38 ou bpm > 120),
+// comparados no ponto fixo que vai no JSON
+static const int16_t SAMPLE_ALERT_TEMP = 3800;   // °C * 100
+static const uint16_t SAMPLE_ALERT_BPM = 120;
+
+inline bool sampleIsAlert(const Sample& s) {
+  bool fever = !(s.flags & SAMPLE_F_TEMP_NAN) && s.temp > SAMPLE_ALERT_TEMP;
+  return fever || s.bpm > SAMPLE_ALERT_BPM;
+}
@@ -0,0 +1,226 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "sample.h"
+#include "sample_stats.h"
+
+// --- Registros agregados (compactação do backlog) ---
+// Sob pressão, janelas antigas vizinhas viram um registro só: a Sample leva
+// o início (ts) e as médias, com SAMPLE_F_AGG, e a extensão leva o fim, a
+// contagem e os extremos. O histórico perde resolução em vez de sumir.
+
+static const uint8_t SAMPLE_F_AGG = 0x08;     // Sample é a parte de um agregado
+static const uint8_t SAMPLE_F_STATS = 0x10;   // janela ao vivo com SampleStats
+
+struct __attribute__((packed)) SampleAgg {
+  uint32_t tsEnd;            // ts da última janela
+  uint16_t count;            // janelas agregadas
+  uint16_t tempN, humN;      // janelas com leitura válida (peso das médias)
+  int16_t  tempMin, tempMax;
+  uint16_t humMin, humMax;
+  uint16_t bpmMin, bpmMax;
+};
+
+// Item do backlog: janela simples (só s), agregado (s + agg) ou janela ao
+// vivo com o resumo estatístico (s + stats, sample_stats.h). O resumo não
+// vai para as filas nem para a flash: só a Sample (recordSample) é guardada.
+struct __attribute__((packed)) SampleRecord {
+  Sample s;
+  union __attribute__((packed)) {
+    SampleAgg agg;
+    SampleStats stats;
+  };
+};
+
+static_assert(sizeof(SampleRecord) == 33, "SampleRecord deve ser empacotado (33 bytes)");
+
+inline bool recordIsAgg(const SampleRecord& r) { return (r.s.flags & SAMPLE_F_AGG) != 0; }
+inline bool recordHasStats(const SampleRecord& r) { return (r.s.flags & SAMPLE_F_STATS) != 0; }
+
+inline SampleRecord sampleRecord(const Sample& s) {
+  SampleRecord r;
+  r.s = s;
+  r.agg = SampleAgg{};
+  return r;
+}
+
+inline SampleRecord sampleRecord(const Sample& s, const SampleStats& stats) {
+  SampleRecord r;
+  r.s = s;
+  r.s.flags |= SAMPLE_F_STATS;
+  r.stats = stats;
+  return r;
+}
+
+// A Sample como vai para o backlog e para o formato binário
+inline Sample recordSample(const SampleRecord& r) {
+  Sample s = r.s;
+  s.flags &= (uint8_t)~SAMPLE_F_STATS;
+  return s;
+}
+
+// Agregado de uma janela só
+inline SampleRecord aggFromSample(const Sample& s) {
+  SampleRecord r;
+  r.s = s;
+  r.s.flags = (uint8_t)((s.flags & (SAMPLE_F_TEMP_NAN | SAMPLE_F_HUM_NAN)) | SAMPLE_F_AGG);
+  bool hasTemp = !(s.flags & SAMPLE_F_TEMP_NAN), hasHum = !(s.flags & SAMPLE_F_HUM_NAN);
+  r.agg.tsEnd = s.ts;
+  r.agg.count = 1;
+  r.agg.tempN = hasTemp;
+  r.agg.humN = hasHum;
+  r.agg.tempMin = r.agg.tempMax = s.temp;
+  r.agg.humMin = r.agg.humMax = s.hum;
+  r.agg.bpmMin = r.agg.bpmMax = s.bpm;
+  return r;
+}
+
+// Junta b em a (em geral a mais antigo). Falso se a contagem passaria de 65535.
+inline bool aggMerge(SampleRecord& a, const SampleRecord& b) {
+  SampleAgg& x = a.agg;
+  const SampleAgg& y = b.agg;
+  if ((uint32_t)x.count + y.count > 0xFFFF) return false;
+  if (y.tempN) {
+    int32_t sum = (int32_t)a.s.temp * x.tempN + (int32_t)b.s.temp * y.tempN;
+    uint32_t n = (uint32_t)x.tempN + y.tempN;
+    a.s.temp = (int16_t)((sum + (sum < 0 ? -(int32_t)n : (int32_t)n) / 2) / (int32_t)n);
+    x.tempMin = x.tempN && x.tempMin < y.tempMin ? x.tempMin : y.tempMin;
+    x.tempMax = x.tempN && x.tempMax > y.tempMax ? x.tempMax : y.tempMax;
+    x.tempN = (uint16_t)n;
+    a.s.flags &= (uint8_t)~SAMPLE_F_TEMP_NAN;
+  }
+  if (y.humN) {
+    uint32_t n = (uint32_t)x.humN + y.humN;
+    a.s.hum = (uint16_t)(((uint32_t)a.s.hum * x.humN + (uint32_t)b.s.hum * y.humN + n / 2) / n);
+    x.humMin = x.humN && x.humMin < y.humMin ? x.humMin : y.humMin;
+    x.humMax = x.humN && x.humMax > y.humMax ? x.humMax : y.humMax;
+    x.humN = (uint16_t)n;
+    a.s.flags &= (uint8_t)~SAMPLE_F_HUM_NAN;
+  }
+  uint32_t n = (uint32_t)x.count + y.count;
+  a.s.bpm = (uint16_t)(((uint32_t)a.s.bpm * x.count + (uint32_t)b.s.bpm * y.count + n / 2) / n);
+  if (y.bpmMin < x.bpmMin) x.bpmMin = y.bpmMin;
+  if (y.bpmMax > x.bpmMax) x.bpmMax = y.bpmMax;
+  x.count = (uint16_t)n;
+  // Normalmente b é mais novo; um alerta despejado pode ser mais antigo
+  if ((int32_t)(b.s.ts - a.s.ts) < 0) a.s.ts = b.s.ts;
+  if ((int32_t)(y.tsEnd - x.tsEnd) > 0) x.tsEnd = y.tsEnd;
+  return true;
+}
+
+// --- Compactador em níveis ---
+// LEVELS anéis de PER_LEVEL agregados. No nível k cada registro cobre até
+// baseWindows * 4^k janelas: uma janela entra no registro mais novo do
+// nível 0 (ou abre outro); com o nível cheio, o registro mais antigo sobe
+// para o nível seguinte, onde se junta ao mais novo se couber. No último
+// nível o primeiro par vizinho (do mais antigo) que cabe em 65535 janelas
+// se junta; só sem nenhum par o mais antigo é descartado. Cada add() custa
+// no máximo LEVELS passos mais PER_LEVEL cópias.
+//
+// Ordem no tempo: último nível (mais antigo) -> nível 0 (mais novo).
+template <size_t LEVELS, size_t PER_LEVEL>
+class SampleCompactor {
+  static_assert(LEVELS > 0 && PER_LEVEL > 1 && PER_LEVEL < 256, "níveis/tamanho inválidos");
+
+public:
+  explicit SampleCompactor(uint16_t baseWindows) : base_(baseWindows) {}
+
+  void add(const Sample& s) {
+    windows_++;
+    push(0, aggFromSample(s));
+  }
+
+  // Agregado mais antigo (sem remover). Retorna false se vazio.
+  bool peek(SampleRecord& out) const {
+    for (size_t k = LEVELS; k-- > 0;) {
+      if (len_[k]) {
+        out = recs_[k][head_[k]];
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void pop() {
+    for (size_t k = LEVELS; k-- > 0;) {
+      if (len_[k]) {
+        windows_ -= recs_[k][head_[k]].agg.count;
+        popOldest(k);
+        return;
+      }
+    }
+  }
+
+  size_t size() const {
+    size_t n = 0;
+    for (size_t k = 0; k < LEVELS; k++) n += len_[k];
+    return n;
+  }
+  uint32_t windows() const { return windows_; }    // janelas representadas
+  uint32_t dropped() const { return dropped_; }    // janelas descartadas
+  static constexpr size_t capacity() { return LEVELS * PER_LEVEL; }
+
+  // Anéis dentro dos limites e contagem de janelas batendo com os
+  // registros, para um estado que veio de fora (retained.h)
+  bool valid() const {
+    uint32_t total = 0;
+    for (size_t k = 0; k < LEVELS; k++) {
+      if (head_[k] >= PER_LEVEL || len_[k] > PER_LEVEL) return false;
+      for (size_t i = 0; i < len_[k]; i++) {
+        const SampleRecord& r = recs_[k][(head_[k] + i) % PER_LEVEL];
+        if (!recordIsAgg(r) || r.agg.count == 0) return false;
+        total += r.agg.count;
+      }
+    }
+    return total == windows_ && base_ > 0;
+  }
+
+private:
+  uint32_t cap(size_t level) const {
+    uint32_t c = base_;
+    for (size_t k = 0; k < level && c < 0xFFFF; k++) c *= 4;
+    return c < 0xFFFF ? c : 0xFFFF;
+  }
+
+  SampleRecord& newest(size_t k) { return recs_[k][(head_[k] + len_[k] - 1) % PER_LEVEL]; }
+
+  SampleRecord popOldest(size_t k) {
+    SampleRecord r = recs_[k][head_[k]];
+    head_[k] = (uint8_t)((head_[k] + 1) % PER_LEVEL);
+    len_[k]--;
+    return r;
+  }
+
+  void push(size_t k, const SampleRecord& r) {
+    if (len_[k] && newest(k).agg.count + r.agg.count <= cap(k) && aggMerge(newest(k), r)) return;
+    if (len_[k] == PER_LEVEL) {
+      if (k + 1 < LEVELS) push(k + 1, popOldest(k));
+      else compactTop(k);
+    }
+    recs_[k][(head_[k] + len_[k]) % PER_LEVEL] = r;
+    len_[k]++;
+  }
+
+  // Último nível cheio: abre uma vaga juntando um par vizinho
+  void compactTop(size_t k) {
+    for (size_t i = 0; i + 1 < len_[k]; i++) {
+      SampleRecord& a = recs_[k][(head_[k] + i) % PER_LEVEL];
+      if (!aggMerge(a, recs_[k][(head_[k] + i + 1) % PER_LEVEL])) continue;
+      for (size_t j = i + 1; j + 1 < len_[k]; j++) {
+        recs_[k][(head_[k] + j) % PER_LEVEL] = recs_[k][(head_[k] + j + 1) % PER_LEVEL];
+      }
+      len_[k]--;
+      return;
+    }
+    SampleRecord old = popOldest(k);   // todos com ~65535 janelas
+    windows_ -= old.agg.count;
+    dropped_ += old.agg.count;
+  }
+
+  SampleRecord recs_[LEVELS][PER_LEVEL];
+  uint8_t head_[LEVELS] = {};
+  uint8_t len_[LEVELS] = {};
+  uint16_t base_;
+  uint32_t windows_ = 0;
+  uint32_t dropped_ = 0;
+};
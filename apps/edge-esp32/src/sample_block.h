@@ -0,0 +1,214 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "sample.h"
+#include "sample_wire.h"
+
+// --- Backlog comprimido em blocos (RAM) ---
+// Amostras vizinhas quase não mudam: ts anda uma janela e temp/hum/bpm
+// derivam devagar. Em vez de 13 bytes por amostra na SampleQueue, o
+// overflow da RAM vai para blocos de BYTES com deltas em varint zigzag
+// (helpers de sample_wire.h). A primeira amostra de cada bloco é keyframe
+// (deltas contra zero), então cada bloco decodifica sozinho. Por amostra:
+//   [cab:1] [dts - janela: zigzag, se cab & BLOCK_F_TS] [dtemp] [dhum] [dbpm]
+// cab = flags da Sample (4 bits) + BLOCK_F_TS quando o ts não andou
+// exatamente uma janela. Uma janela típica ocupa 4 bytes.
+//
+// Anel de BLOCKS blocos: push() escreve no mais novo e abre outro quando
+// não cabe o pior caso (O(1)); peek()/pop() leem o mais antigo com um
+// cursor, sem descomprimir o bloco inteiro. Cheio, o chamador esvazia o
+// bloco mais antigo (evictBlock) antes do push.
+static const uint8_t BLOCK_F_TS = 0x10;   // dts diferente da janela
+
+template <size_t BLOCKS, size_t BYTES>
+class SampleBlockLog {
+  static_assert(BLOCKS > 1 && BLOCKS < 256, "BLOCKS entre 2 e 255");
+  static_assert(BYTES >= 2 * WIRE_SAMPLE_MAX && BYTES < 0xFFFF, "bloco pequeno demais");
+
+public:
+  explicit SampleBlockLog(uint32_t windowMs) : window_(windowMs) {}
+
+  // false se não há bloco livre (chame evictBlock antes)
+  bool push(const Sample& s) {
+    if (len_ == 0 || BYTES - blocks_[newest()].len < WIRE_SAMPLE_MAX) {
+      if (len_ == BLOCKS) return false;
+      Block& b = blocks_[(head_ + len_) % BLOCKS];
+      b.len = 0;
+      b.count = 0;
+      len_++;
+      enc_ = Codec();
+    }
+    Block& b = blocks_[newest()];
+    b.len = (uint16_t)(b.len + enc_.put(s, window_, b.data + b.len));
+    b.count++;
+    samples_++;
+    return true;
+  }
+
+  // Precisa de evictBlock() antes de caber mais uma amostra
+  bool full() const {
+    return len_ == BLOCKS && BYTES - blocks_[newest()].len < WIRE_SAMPLE_MAX;
+  }
+
+  bool peek(Sample& out) {
+    if (!samples_) return false;
+    if (!cached_) {
+      const Block& b = blocks_[head_];
+      const uint8_t* p = b.data + readPos_;
+      if (!dec_.get(p, b.data + b.len, window_, next_)) return false;   // bloco corrompido
+      nextPos_ = (uint16_t)(p - b.data);
+      cached_ = true;
+    }
+    out = next_;
+    return true;
+  }
+
+  void pop() {
+    Sample s;
+    if (!peek(s)) return;
+    cached_ = false;
+    readPos_ = nextPos_;
+    samples_--;
+    if (++readCount_ == blocks_[head_].count) dropHead();
+  }
+
+  // Esvazia o bloco mais antigo, em ordem, passando cada amostra a sink
+  template <typename Sink>
+  void evictBlock(Sink sink) {
+    if (!len_) return;
+    size_t left = blocks_[head_].count - readCount_;
+    Sample s;
+    for (size_t i = 0; i < left && peek(s); i++) {
+      sink(s);
+      pop();
+    }
+  }
+
+  size_t size() const { return samples_; }
+  size_t blocks() const { return len_; }
+  size_t bytesUsed() const {
+    size_t n = 0;
+    for (size_t i = 0; i < len_; i++) n += blocks_[(head_ + i) % BLOCKS].len;
+    return n;
+  }
+  static constexpr size_t capacityBytes() { return BLOCKS * BYTES; }
+
+  // Cada bloco decodifica exatamente no tamanho e na contagem gravados, o
+  // cursor de leitura (posição, delta e amostra em cache) bate com o ponto
+  // em que está no mais antigo e o delta de escrita com o fim do mais novo,
+  // para um estado que veio de fora (retained.h). O(bytes usados).
+  bool valid() const {
+    if (head_ >= BLOCKS || len_ > BLOCKS) return false;
+    if (len_ == 0 && (samples_ || readCount_ || cached_)) return false;
+    size_t cursor = readCount_ + (cached_ ? 1 : 0);   // amostras já decodificadas no mais antigo
+    size_t total = 0;
+    for (size_t i = 0; i < len_; i++) {
+      const Block& b = blocks_[(head_ + i) % BLOCKS];
+      if (b.len > BYTES || b.count == 0) return false;
+      Codec c;
+      Sample s;
+      const uint8_t* p = b.data;
+      for (size_t k = 0;; k++) {
+        size_t pos = (size_t)(p - b.data);
+        if (i == 0 && k == readCount_ && pos != readPos_) return false;
+        if (i == 0 && k == cursor) {
+          if (!c.same(dec_) || (cached_ && (pos != nextPos_ || memcmp(&s, &next_, sizeof(s)) != 0))) return false;
+        }
+        if (k == b.count) break;
+        if (!c.get(p, b.data + b.len, window_, s)) return false;
+      }
+      if (p != b.data + b.len) return false;
+      if (i + 1 == len_ && !c.same(enc_)) return false;
+      total += b.count;
+    }
+    if (len_ && readCount_ >= blocks_[head_].count) return false;
+    return total - readCount_ == samples_;
+  }
+
+private:
+  // Estado do delta; zerado no início de cada bloco (keyframe)
+  struct Codec {
+    uint32_t ts = 0;
+    int32_t temp = 0, hum = 0, bpm = 0;
+
+    bool same(const Codec& o) const { return ts == o.ts && temp == o.temp && hum == o.hum && bpm == o.bpm; }
+
+    size_t put(const Sample& s, uint32_t window, uint8_t* out) {
+      uint8_t* p = out;
+      uint32_t dts = s.ts - ts - window;
+      uint8_t* hdr = p++;
+      *hdr = (uint8_t)(s.flags & 0x0F);
+      if (dts) {
+        *hdr |= BLOCK_F_TS;
+        p = wirePutVarint(p, wireZigzag((int32_t)dts));
+      }
+      ts = s.ts;
+      if (!(s.flags & SAMPLE_F_TEMP_NAN)) {
+        p = wirePutVarint(p, wireZigzag((int32_t)s.temp - temp));
+        temp = s.temp;
+      }
+      if (!(s.flags & SAMPLE_F_HUM_NAN)) {
+        p = wirePutVarint(p, wireZigzag((int32_t)s.hum - hum));
+        hum = s.hum;
+      }
+      p = wirePutVarint(p, wireZigzag((int32_t)s.bpm - bpm));
+      bpm = s.bpm;
+      return (size_t)(p - out);
+    }
+
+    bool get(const uint8_t*& p, const uint8_t* end, uint32_t window, Sample& s) {
+      uint32_t v = 0;
+      if (p >= end) return false;
+      uint8_t hdr = *p++;
+      s.flags = (uint8_t)(hdr & 0x0F);
+      if ((hdr & BLOCK_F_TS) && !wireGetVarint(p, end, v)) return false;
+      ts += window + (uint32_t)wireUnzigzag(v);
+      s.ts = ts;
+      s.temp = 0;
+      if (!(s.flags & SAMPLE_F_TEMP_NAN)) {
+        if (!wireGetVarint(p, end, v)) return false;
+        temp += wireUnzigzag(v);
+        s.temp = (int16_t)temp;
+      }
+      s.hum = 0;
+      if (!(s.flags & SAMPLE_F_HUM_NAN)) {
+        if (!wireGetVarint(p, end, v)) return false;
+        hum += wireUnzigzag(v);
+        s.hum = (uint16_t)hum;
+      }
+      if (!wireGetVarint(p, end, v)) return false;
+      bpm += wireUnzigzag(v);
+      s.bpm = (uint16_t)bpm;
+      return true;
+    }
+  };
+
+  struct Block {
+    uint16_t len;     // bytes escritos
+    uint16_t count;   // amostras
+    uint8_t data[BYTES];
+  };
+
+  size_t newest() const { return (head_ + len_ - 1) % BLOCKS; }
+
+  void dropHead() {
+    head_ = (uint8_t)((head_ + 1) % BLOCKS);
+    len_--;
+    readPos_ = 0;
+    readCount_ = 0;
+    dec_ = Codec();
+  }
+
+  Block blocks_[BLOCKS];
+  uint8_t head_ = 0;
+  uint8_t len_ = 0;
+  size_t samples_ = 0;
+  uint32_t window_;
+  Codec enc_;                  // delta do bloco mais novo
+  Codec dec_;                  // cursor de leitura no bloco mais antigo
+  uint16_t readPos_ = 0, nextPos_ = 0;
+  uint16_t readCount_ = 0;
+  bool cached_ = false;
+  Sample next_;
+};
@@ -0,0 +1,156 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "sample.h"
+#include "sample_agg.h"
+
+// --- Serialização JSON sem alocação ---
+// Escreve a amostra em um buffer fixo do chamador. Saída idêntica byte a byte
+// ao formato anterior (String += / String(float, 2)):
+// {"ts":<millis>,"temp":<C>,"hum":<%>,"bpm":<int>,"connected":<bool>}
+// Exceção: zero negativo (-0,0 do DHT22, ou entre -0,005 e 0) sai "0.00" em
+// vez de "-0.00", porque o ponto fixo da Sample não tem sinal no zero.
+// Agregados (sample_agg.h) levam início/fim, contagem, médias e extremos:
+// {"ts","ts_end","n","temp","temp_min","temp_max","hum",...,"bpm_max"}
+// Janelas ao vivo com resumo (sample_stats.h) acrescentam ao objeto simples
+// "dht_n" e, havendo leituras, "temp_mean/sd/min/max" e "hum_*"; depois
+// "ibi_n" e "sdnn"/"rmssd" (ms) quando há intervalos suficientes.
+
+// Pior caso: {"ts":4294967295,"temp":-327.68,"hum":655.35,"bpm":65535,"connected":false}
+static const size_t SAMPLE_JSON_MAX = 96;
+// Pior caso do registro (janela com resumo): 271 caracteres
+static const size_t RECORD_JSON_MAX = 272;
+
+namespace sample_json_detail {
+
+inline char* putStr(char* p, const char* s) {
+  while (*s) *p++ = *s++;
+  return p;
+}
+
+inline char* putU32(char* p, uint32_t v) {
+  char tmp[10];
+  int n = 0;
+  do { tmp[n++] = (char)('0' + v % 10); v /= 10; } while (v);
+  while (n) *p++ = tmp[--n];
+  return p;
+}
+
+// Valor em centésimos com 2 casas fixas (ex.: -523 -> "-5.23")
+inline char* putCenti(char* p, int32_t centi) {
+  if (centi < 0) { *p++ = '-'; centi = -centi; }
+  p = putU32(p, (uint32_t)centi / 100);
+  uint32_t frac = (uint32_t)centi % 100;
+  *p++ = '.';
+  *p++ = (char)('0' + frac / 10);
+  *p++ = (char)('0' + frac % 10);
+  return p;
+}
+
+// Décimos com 1 casa (ex.: 453 -> "45.3")
+inline char* putDeci(char* p, uint32_t deci) {
+  p = putU32(p, deci / 10);
+  *p++ = '.';
+  *p++ = (char)('0' + deci % 10);
+  return p;
+}
+
+inline char* putStats(char* p, const SampleStats& st) {
+  p = putStr(p, ",\"dht_n\":");
+  p = putU32(p, st.dhtN);
+  if (st.dhtN) {
+    p = putStr(p, ",\"temp_mean\":");
+    p = putCenti(p, st.tempMean);
+    p = putStr(p, ",\"temp_sd\":");
+    p = putCenti(p, st.tempSd);
+    p = putStr(p, ",\"temp_min\":");
+    p = putCenti(p, st.tempMin);
+    p = putStr(p, ",\"temp_max\":");
+    p = putCenti(p, st.tempMax);
+    p = putStr(p, ",\"hum_mean\":");
+    p = putCenti(p, st.humMean);
+    p = putStr(p, ",\"hum_sd\":");
+    p = putCenti(p, st.humSd);
+    p = putStr(p, ",\"hum_min\":");
+    p = putCenti(p, st.humMin);
+    p = putStr(p, ",\"hum_max\":");
+    p = putCenti(p, st.humMax);
+  }
+  p = putStr(p, ",\"ibi_n\":");
+  p = putU32(p, st.ibiN);
+  if (st.sdnn != SAMPLE_STAT_NONE) {
+    p = putStr(p, ",\"sdnn\":");
+    p = putDeci(p, st.sdnn);
+  }
+  if (st.rmssd != SAMPLE_STAT_NONE) {
+    p = putStr(p, ",\"rmssd\":");
+    p = putDeci(p, st.rmssd);
+  }
+  return p;
+}
+
+} // namespace sample_json_detail
+
+// Retorna o tamanho escrito (sem o '\0'), ou 0 se cap < SAMPLE_JSON_MAX.
+inline size_t formatSampleJson(char* out, size_t cap, const Sample& s) {
+  using namespace sample_json_detail;
+  if (cap < SAMPLE_JSON_MAX) return 0;
+  char* p = out;
+  p = putStr(p, "{\"ts\":");
+  p = putU32(p, s.ts);
+  p = putStr(p, ",\"temp\":");
+  p = (s.flags & SAMPLE_F_TEMP_NAN) ? putStr(p, "nan") : putCenti(p, s.temp);
+  p = putStr(p, ",\"hum\":");
+  p = (s.flags & SAMPLE_F_HUM_NAN) ? putStr(p, "nan") : putCenti(p, s.hum);
+  p = putStr(p, ",\"bpm\":");
+  p = putU32(p, s.bpm);
+  p = putStr(p, (s.flags & SAMPLE_F_CONNECTED) ? ",\"connected\":true}" : ",\"connected\":false}");
+  *p = '\0';
+  return (size_t)(p - out);
+}
+
+// Janela simples ou agregado. Retorna 0 se cap < RECORD_JSON_MAX.
+inline size_t formatRecordJson(char* out, size_t cap, const SampleRecord& r) {
+  using namespace sample_json_detail;
+  if (cap < RECORD_JSON_MAX) return 0;
+  if (recordHasStats(r)) {
+    // Reabre o objeto simples para acrescentar o resumo
+    char* p = out + formatSampleJson(out, cap, recordSample(r)) - 1;
+    p = putStats(p, r.stats);
+    *p++ = '}';
+    *p = '\0';
+    return (size_t)(p - out);
+  }
+  if (!recordIsAgg(r)) return formatSampleJson(out, cap, r.s);
+  const Sample& s = r.s;
+  const SampleAgg& a = r.agg;
+  bool noTemp = s.flags & SAMPLE_F_TEMP_NAN, noHum = s.flags & SAMPLE_F_HUM_NAN;
+  char* p = out;
+  p = putStr(p, "{\"ts\":");
+  p = putU32(p, s.ts);
+  p = putStr(p, ",\"ts_end\":");
+  p = putU32(p, a.tsEnd);
+  p = putStr(p, ",\"n\":");
+  p = putU32(p, a.count);
+  p = putStr(p, ",\"temp\":");
+  p = noTemp ? putStr(p, "nan") : putCenti(p, s.temp);
+  p = putStr(p, ",\"temp_min\":");
+  p = noTemp ? putStr(p, "nan") : putCenti(p, a.tempMin);
+  p = putStr(p, ",\"temp_max\":");
+  p = noTemp ? putStr(p, "nan") : putCenti(p, a.tempMax);
+  p = putStr(p, ",\"hum\":");
+  p = noHum ? putStr(p, "nan") : putCenti(p, s.hum);
+  p = putStr(p, ",\"hum_min\":");
+  p = noHum ? putStr(p, "nan") : putCenti(p, a.humMin);
+  p = putStr(p, ",\"hum_max\":");
+  p = noHum ? putStr(p, "nan") : putCenti(p, a.humMax);
+  p = putStr(p, ",\"bpm\":");
+  p = putU32(p, s.bpm);
+  p = putStr(p, ",\"bpm_min\":");
+  p = putU32(p, a.bpmMin);
+  p = putStr(p, ",\"bpm_max\":");
+  p = putU32(p, a.bpmMax);
+  *p++ = '}';
+  *p = '\0';
+  return (size_t)(p - out);
+}
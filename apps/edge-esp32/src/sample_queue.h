@@ -0,0 +1,135 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "sample.h"
+
+// --- Fila de amostras com prioridade para alertas ---
+// Capacidade fixa, sem alocação: N posições compartilhadas por duas filas
+// FIFO encadeadas (alerta e normal, ver sampleIsAlert()). Cheia, descarta a
+// normal mais antiga; só sem normais na fila descarta um alerta (o mais
+// antigo), e uma normal nova é que fica de fora. Na saída (peek/pop) os
+// alertas vêm antes, cada classe em ordem de chegada. Tudo O(1): cada
+// posição guarda o índice da próxima da sua fila (2 bytes a mais).
+template <size_t N>
+class SampleQueue {
+  static_assert(N > 0 && N < 0xFFFF, "N entre 1 e 65534");
+
+public:
+  // Retorna false se alguma amostra (esta ou uma antiga) foi descartada
+  bool push(const Sample& s) {
+    uint8_t cls = sampleIsAlert(s) ? ALERT : NORMAL;
+    bool kept = true;
+    uint16_t slot = alloc();
+    if (slot == NIL) {
+      kept = false;
+      if (lists_[NORMAL].count == 0 && cls == NORMAL) {
+        dropped_[NORMAL]++;   // só alertas na fila: a normal nova fica de fora
+        return false;
+      }
+      uint8_t victim = lists_[NORMAL].count ? NORMAL : ALERT;
+      slot = unlinkHead(victim);
+      dropped_[victim]++;
+    }
+    buf_[slot] = s;
+    List& l = lists_[cls];
+    next_[slot] = NIL;
+    if (l.count) next_[l.tail] = slot;
+    else l.head = slot;
+    l.tail = slot;
+    l.count++;
+    return kept;
+  }
+
+  // Próxima a sair (alerta mais antigo, senão normal mais antiga)
+  bool peek(Sample& out) const {
+    const List& l = lists_[lists_[ALERT].count ? ALERT : NORMAL];
+    if (l.count == 0) return false;
+    out = buf_[l.head];
+    return true;
+  }
+
+  void pop() {
+    uint8_t cls = lists_[ALERT].count ? ALERT : NORMAL;
+    if (lists_[cls].count) release(unlinkHead(cls));
+  }
+
+  // Remove a próxima na ordem de descarte (normal mais antiga, senão
+  // alerta mais antigo): para mover amostras para fora da RAM sem perda
+  bool popEvictable(Sample& out) {
+    uint8_t cls = lists_[NORMAL].count ? NORMAL : ALERT;
+    if (lists_[cls].count == 0) return false;
+    uint16_t slot = unlinkHead(cls);
+    out = buf_[slot];
+    release(slot);
+    return true;
+  }
+
+  size_t size() const { return lists_[NORMAL].count + lists_[ALERT].count; }
+  size_t alerts() const { return lists_[ALERT].count; }
+  bool empty() const { return size() == 0; }
+  bool full() const { return size() == N; }
+  static constexpr size_t capacity() { return N; }
+  uint32_t droppedNormal() const { return dropped_[NORMAL]; }
+  uint32_t droppedAlert() const { return dropped_[ALERT]; }
+
+  // Estrutura coerente (listas dentro do buffer e sem ciclos), para um
+  // estado que veio de fora (retained.h). O(N).
+  bool valid() const {
+    if (used_ > N) return false;
+    size_t linked = 0;
+    for (uint8_t cls = NORMAL; cls <= ALERT; cls++) {
+      const List& l = lists_[cls];
+      uint16_t slot = l.head, last = NIL;
+      for (size_t i = 0; i < l.count; i++) {
+        if (slot >= used_) return false;
+        last = slot;
+        slot = next_[slot];
+      }
+      if (slot != NIL || last != (l.count ? l.tail : NIL)) return false;
+      linked += l.count;
+    }
+    for (uint16_t slot = free_; slot != NIL; slot = next_[slot]) {
+      if (slot >= used_ || ++linked > used_) return false;
+    }
+    return linked == used_;
+  }
+
+private:
+  enum : uint8_t { NORMAL, ALERT };
+  static const uint16_t NIL = 0xFFFF;
+
+  struct List {
+    uint16_t head = NIL, tail = NIL;
+    uint16_t count = 0;
+  };
+
+  // Posição livre: recicladas primeiro, depois as nunca usadas
+  uint16_t alloc() {
+    if (free_ != NIL) {
+      uint16_t slot = free_;
+      free_ = next_[slot];
+      return slot;
+    }
+    return used_ < N ? used_++ : NIL;
+  }
+
+  void release(uint16_t slot) {
+    next_[slot] = free_;
+    free_ = slot;
+  }
+
+  uint16_t unlinkHead(uint8_t cls) {
+    List& l = lists_[cls];
+    uint16_t slot = l.head;
+    l.head = next_[slot];
+    if (--l.count == 0) l.tail = NIL;
+    return slot;
+  }
+
+  Sample buf_[N];
+  uint16_t next_[N];
+  List lists_[2];
+  uint16_t free_ = NIL;
+  uint16_t used_ = 0;
+  uint32_t dropped_[2] = {0, 0};
+};
@@ -0,0 +1,123 @@
+#pragma once
+#include <math.h>
+#include <stdint.h>
+
+// --- Estatísticas por janela (streaming) ---
+// Além do último valor, cada janela pode levar o resumo do que aconteceu
+// dentro dela: média, desvio padrão e extremos das leituras do DHT e a
+// variabilidade dos intervalos entre batimentos (HRV). Tudo em acumuladores
+// de uma passada, O(1) por evento e sem guardar as leituras: o DHT alimenta
+// a cada leitura válida, o consumo dos batimentos a cada IBI aceito (na
+// tarefa de sensoriamento, não na ISR) e o fechamento da janela tira o
+// resumo e zera.
+
+// Welford: média e variância sem somas grandes (estável em float)
+struct RunningStats {
+  uint16_t n = 0;
+  float mean = 0, m2 = 0, min = 0, max = 0;
+
+  void add(float x) {
+    n++;
+    float d = x - mean;
+    mean += d / n;
+    m2 += d * (x - mean);
+    if (n == 1 || x < min) min = x;
+    if (n == 1 || x > max) max = x;
+  }
+
+  float variance() const { return n > 1 ? m2 / (n - 1) : 0.0f; }   // amostral
+  float sd() const { return sqrtf(variance()); }
+  void reset() { *this = RunningStats(); }
+};
+
+// IBIs: SDNN é o desvio padrão dos intervalos (Welford) e RMSSD a raiz da
+// média dos quadrados das diferenças entre intervalos seguidos. A diferença
+// atravessa o fechamento da janela; uma pausa (breakChain) não.
+struct IbiStats {
+  RunningStats ibi;     // µs
+  float sumSqDiff = 0;  // µs²
+  uint16_t diffs = 0;
+  uint32_t prevUs = 0;
+
+  void add(uint32_t ibiUs) {
+    ibi.add((float)ibiUs);
+    if (prevUs) {
+      float d = (float)ibiUs - (float)prevUs;
+      sumSqDiff += d * d;
+      diffs++;
+    }
+    prevUs = ibiUs;
+  }
+
+  void breakChain() { prevUs = 0; }
+  float sdnnUs() const { return ibi.sd(); }
+  float rmssdUs() const { return diffs ? sqrtf(sumSqDiff / diffs) : 0.0f; }
+  void resetWindow() {
+    ibi.reset();
+    sumSqDiff = 0;
+    diffs = 0;
+  }
+};
+
+// Resumo da janela em ponto fixo, como a Sample (°C/% * 100). Cabe no
+// espaço da extensão do SampleRecord (sample_agg.h).
+static const uint16_t SAMPLE_STAT_NONE = 0xFFFF;   // sdnn/rmssd sem dados
+
+struct __attribute__((packed)) SampleStats {
+  uint8_t  dhtN;                        // leituras válidas do DHT
+  uint8_t  ibiN;                        // IBIs aceitos
+  int16_t  tempMean, tempMin, tempMax;
+  uint16_t tempSd;
+  uint16_t humMean, humSd, humMin, humMax;
+  uint16_t sdnn, rmssd;                 // ms * 10, ou SAMPLE_STAT_NONE
+};
+
+static_assert(sizeof(SampleStats) == 22, "SampleStats deve ser empacotada (22 bytes)");
+
+inline int16_t statCentiS(float v) {
+  long c = lroundf(v * 100.0f);
+  return (int16_t)(c < -32768 ? -32768 : c > 32767 ? 32767 : c);
+}
+
+inline uint16_t statCentiU(float v) {
+  long c = lroundf(v * 100.0f);
+  return (uint16_t)(c < 0 ? 0 : c > 65535 ? 65535 : c);
+}
+
+// µs -> ms * 10, saturando antes do valor reservado
+inline uint16_t statDeciMs(float us) {
+  long d = lroundf(us / 100.0f);
+  return (uint16_t)(d < 0 ? 0 : d >= SAMPLE_STAT_NONE ? SAMPLE_STAT_NONE - 1 : d);
+}
+
+// Acumuladores da janela corrente
+struct WindowStats {
+  RunningStats temp, hum;
+  IbiStats ibi;
+
+  void addDht(float temperature, float humidity) {
+    temp.add(temperature);
+    hum.add(humidity);
+  }
+
+  // Resumo da janela que fecha; zera para a próxima
+  SampleStats close() {
+    SampleStats s;
+    s.dhtN = (uint8_t)(temp.n > 255 ? 255 : temp.n);
+    s.ibiN = (uint8_t)(ibi.ibi.n > 255 ? 255 : ibi.ibi.n);
+    s.tempMean = statCentiS(temp.mean);
+    s.tempSd = statCentiU(temp.sd());
+    s.tempMin = statCentiS(temp.min);
+    s.tempMax = statCentiS(temp.max);
+    s.humMean = statCentiU(hum.mean);
+    s.humSd = statCentiU(hum.sd());
+    s.humMin = statCentiU(hum.min);
+    s.humMax = statCentiU(hum.max);
+    s.sdnn = ibi.ibi.n > 1 ? statDeciMs(ibi.sdnnUs()) : SAMPLE_STAT_NONE;
+    s.rmssd = ibi.diffs ? statDeciMs(ibi.rmssdUs()) : SAMPLE_STAT_NONE;
+    temp.reset();
+    hum.reset();
+    ibi.resetWindow();
+    return s;
+  }
+};
@@ -0,0 +1,153 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "sample.h"
+
+// --- Formato binário compacto (v1) ---
+// Alternativa ao JSON para enlaces pagos por byte. Lote:
+//   [versão:1] [n: varint] n x amostra
+// Amostra (deltas em relação à anterior do lote; a primeira parte de zero):
+//   [flags:1] [dts: varint] [dtemp: zigzag] [dhum: zigzag] [dbpm: zigzag]
+// temp/hum em centésimos (ponto fixo da Sample). Campos marcados como NaN
+// nas flags são omitidos. Uma amostra típica de janela ocupa ~6 bytes
+// contra ~64 do JSON.
+//
+// Versão 2: o mesmo lote atrás do envelope da entrega confirmada (main.cpp),
+//   [versão:1] [boot: varint] [seq: varint] [base: varint] [n: varint] ...
+// para o consumidor deduplicar o binário pelo mesmo boot/seq do JSON.
+
+static const uint8_t WIRE_VERSION = 1;
+static const uint8_t WIRE_VERSION_ENVELOPE = 2;
+static const size_t WIRE_SAMPLE_MAX = 1 + 5 + 3 + 3 + 3;  // pior caso por amostra
+static const size_t WIRE_HEADER_MAX = 1 + 3 * 5 + 5;      // versão, envelope e n
+
+struct WireEnvelope {
+  uint32_t boot, seq, base;
+};
+
+inline constexpr size_t wireBatchMax(size_t n) { return WIRE_HEADER_MAX + n * WIRE_SAMPLE_MAX; }
+
+inline uint8_t* wirePutVarint(uint8_t* p, uint32_t v) {
+  while (v >= 0x80) { *p++ = (uint8_t)(v | 0x80); v >>= 7; }
+  *p++ = (uint8_t)v;
+  return p;
+}
+
+inline uint32_t wireZigzag(int32_t v) { return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31); }
+inline int32_t wireUnzigzag(uint32_t v) { return (int32_t)(v >> 1) ^ -(int32_t)(v & 1); }
+
+// Retorna false se o buffer terminar no meio do varint
+inline bool wireGetVarint(const uint8_t*& p, const uint8_t* end, uint32_t& v) {
+  v = 0;
+  for (int shift = 0; shift < 35; shift += 7) {
+    if (p >= end) return false;
+    uint8_t b = *p++;
+    v |= (uint32_t)(b & 0x7F) << shift;
+    if (!(b & 0x80)) return true;
+  }
+  return false;
+}
+
+// Codificador com estado (delta contra a amostra anterior)
+class WireEncoder {
+public:
+  void reset() { ts_ = 0; temp_ = 0; hum_ = 0; bpm_ = 0; }
+
+  // Escreve a amostra em out (>= WIRE_SAMPLE_MAX livres); retorna bytes escritos
+  size_t put(const Sample& s, uint8_t* out) {
+    uint8_t* p = out;
+    *p++ = s.flags;
+    p = wirePutVarint(p, s.ts - ts_);
+    ts_ = s.ts;
+    if (!(s.flags & SAMPLE_F_TEMP_NAN)) {
+      p = wirePutVarint(p, wireZigzag((int32_t)s.temp - temp_));
+      temp_ = s.temp;
+    }
+    if (!(s.flags & SAMPLE_F_HUM_NAN)) {
+      p = wirePutVarint(p, wireZigzag((int32_t)s.hum - hum_));
+      hum_ = s.hum;
+    }
+    p = wirePutVarint(p, wireZigzag((int32_t)s.bpm - bpm_));
+    bpm_ = s.bpm;
+    return (size_t)(p - out);
+  }
+
+private:
+  uint32_t ts_ = 0;
+  int32_t temp_ = 0, hum_ = 0, bpm_ = 0;
+};
+
+class WireDecoder {
+public:
+  void reset() { ts_ = 0; temp_ = 0; hum_ = 0; bpm_ = 0; }
+
+  // Lê uma amostra de [p, end); avança p. Retorna false se truncada.
+  bool get(const uint8_t*& p, const uint8_t* end, Sample& s) {
+    uint32_t v;
+    if (p >= end) return false;
+    s.flags = *p++;
+    if (!wireGetVarint(p, end, v)) return false;
+    ts_ += v;
+    s.ts = ts_;
+    s.temp = 0;
+    if (!(s.flags & SAMPLE_F_TEMP_NAN)) {
+      if (!wireGetVarint(p, end, v)) return false;
+      temp_ += wireUnzigzag(v);
+      s.temp = (int16_t)temp_;
+    }
+    s.hum = 0;
+    if (!(s.flags & SAMPLE_F_HUM_NAN)) {
+      if (!wireGetVarint(p, end, v)) return false;
+      hum_ += wireUnzigzag(v);
+      s.hum = (uint16_t)hum_;
+    }
+    if (!wireGetVarint(p, end, v)) return false;
+    bpm_ += wireUnzigzag(v);
+    s.bpm = (uint16_t)bpm_;
+    return true;
+  }
+
+private:
+  uint32_t ts_ = 0;
+  int32_t temp_ = 0, hum_ = 0, bpm_ = 0;
+};
+
+// Lote completo, com envelope (v2) se env; out precisa de wireBatchMax(n)
+// bytes. Retorna o tamanho.
+inline size_t wireEncodeBatch(const Sample* samples, size_t n, uint8_t* out,
+                              const WireEnvelope* env = nullptr) {
+  uint8_t* p = out;
+  *p++ = env ? WIRE_VERSION_ENVELOPE : WIRE_VERSION;
+  if (env) {
+    p = wirePutVarint(p, env->boot);
+    p = wirePutVarint(p, env->seq);
+    p = wirePutVarint(p, env->base);
+  }
+  p = wirePutVarint(p, (uint32_t)n);
+  WireEncoder enc;
+  for (size_t i = 0; i < n; i++) p += enc.put(samples[i], p);
+  return (size_t)(p - out);
+}
+
+// Retorna o número de amostras decodificadas, ou -1 se inválido/truncado.
+// Um lote v2 preenche env (se dado); um v1 não mexe nele.
+inline int wireDecodeBatch(const uint8_t* in, size_t len, Sample* out, size_t maxN,
+                           WireEnvelope* env = nullptr) {
+  const uint8_t* p = in;
+  const uint8_t* end = in + len;
+  uint32_t n;
+  if (len < 2 || (*p != WIRE_VERSION && *p != WIRE_VERSION_ENVELOPE)) return -1;
+  if (*p++ == WIRE_VERSION_ENVELOPE) {
+    WireEnvelope e;
+    if (!wireGetVarint(p, end, e.boot) || !wireGetVarint(p, end, e.seq) || !wireGetVarint(p, end, e.base)) {
+      return -1;
+    }
+    if (env) *env = e;
+  }
+  if (!wireGetVarint(p, end, n) || n > maxN) return -1;
+  WireDecoder dec;
+  for (uint32_t i = 0; i < n; i++) {
+    if (!dec.get(p, end, out[i])) return -1;
+  }
+  return (int)n;
+}
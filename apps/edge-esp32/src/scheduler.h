@@ -0,0 +1,151 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// --- Agenda de prazos ---
+// Jobs com prazo em millis() num min-heap de tamanho fixo (sem alocação).
+// O laço só olha o topo: runDue() executa o que venceu e nextDueIn() diz
+// quanto dormir. Um job a mais custa O(log N) quando é armado ou vence, e
+// nada nas iterações em que não vence.
+//
+// Prazos comparados pela diferença com sinal ((int32_t)(a - b)), o que
+// continua certo na volta do millis() (~49,7 dias) enquanto os prazos
+// armados estiverem a menos de ~24 dias de now.
+//
+// Job com período volta com cadência fixa (prazo + período); se o novo
+// prazo também já passou, ressincroniza em now + período. Sem período, o
+// job é de disparo único e fica desarmado até o próximo at()/after().
+typedef void (*SchedJobFn)();
+
+template<size_t N>
+class Scheduler {
+  static_assert(N > 0 && N < 255, "N entre 1 e 254");
+
+public:
+  static const uint8_t NONE = 0xFF;
+
+  // Registra um job (desarmado); devolve o id
+  uint8_t add(SchedJobFn fn, uint32_t periodMs = 0) {
+    if (count_ == N) return NONE;
+    Job& j = jobs_[count_];
+    j.fn = fn;
+    j.periodMs = periodMs;
+    j.slot = NONE;
+    return count_++;
+  }
+
+  // (Re)arma para dueMs
+  void at(uint8_t id, uint32_t dueMs) {
+    Job& j = jobs_[id];
+    j.dueMs = dueMs;
+    if (j.slot == NONE) {
+      j.slot = heapLen_;
+      heap_[heapLen_++] = id;
+      siftUp(j.slot);
+    } else {
+      siftUp(j.slot);
+      siftDown(j.slot);
+    }
+  }
+  void after(uint8_t id, uint32_t now, uint32_t delayMs) { at(id, now + delayMs); }
+  // Arma em now + delayMs, a não ser que já esteja armado para antes
+  void atMost(uint8_t id, uint32_t now, uint32_t delayMs) {
+    uint32_t due = now + delayMs;
+    if (!armed(id) || before(due, jobs_[id].dueMs)) at(id, due);
+  }
+
+  void cancel(uint8_t id) {
+    uint8_t slot = jobs_[id].slot;
+    if (slot == NONE) return;
+    jobs_[id].slot = NONE;
+    heapLen_--;
+    if (slot == heapLen_) return;
+    heap_[slot] = heap_[heapLen_];
+    jobs_[heap_[slot]].slot = slot;
+    siftUp(slot);
+    siftDown(jobs_[heap_[slot]].slot);
+  }
+
+  bool armed(uint8_t id) const { return jobs_[id].slot != NONE; }
+
+  // Executa os jobs vencidos em ordem de prazo; um job rearmado para já
+  // dentro de um job roda na próxima chamada. Devolve quantos rodaram.
+  size_t runDue(uint32_t now) {
+    size_t ran = 0;
+    pass_++;
+    while (heapLen_ > 0) {
+      uint8_t id = heap_[0];
+      Job& j = jobs_[id];
+      if (before(now, j.dueMs) || j.pass == pass_) break;
+      j.pass = pass_;
+      lateMs_ = now - j.dueMs;
+      if (j.periodMs > 0) {
+        uint32_t next = j.dueMs + j.periodMs;
+        if (!before(now, next)) next = now + j.periodMs;
+        at(id, next);
+      } else {
+        cancel(id);
+      }
+      j.fn();
+      ran++;
+    }
+    return ran;
+  }
+
+  // Milissegundos até o próximo prazo (0 se já venceu, UINT32_MAX se nada armado)
+  uint32_t nextDueIn(uint32_t now) const {
+    if (heapLen_ == 0) return UINT32_MAX;
+    int32_t d = (int32_t)(jobs_[heap_[0]].dueMs - now);
+    return d > 0 ? (uint32_t)d : 0;
+  }
+
+  // Atraso do job em execução em relação ao prazo (para jitter)
+  uint32_t lateMs() const { return lateMs_; }
+
+private:
+  struct Job {
+    SchedJobFn fn;
+    uint32_t periodMs;
+    uint32_t dueMs;
+    uint32_t pass;
+    uint8_t slot;   // posição no heap, ou NONE se desarmado
+  };
+
+  static bool before(uint32_t a, uint32_t b) { return (int32_t)(a - b) < 0; }
+
+  void swap(uint8_t a, uint8_t b) {
+    uint8_t t = heap_[a];
+    heap_[a] = heap_[b];
+    heap_[b] = t;
+    jobs_[heap_[a]].slot = a;
+    jobs_[heap_[b]].slot = b;
+  }
+
+  void siftUp(uint8_t i) {
+    while (i > 0) {
+      uint8_t parent = (i - 1) / 2;
+      if (!before(jobs_[heap_[i]].dueMs, jobs_[heap_[parent]].dueMs)) break;
+      swap(i, parent);
+      i = parent;
+    }
+  }
+
+  void siftDown(uint8_t i) {
+    for (;;) {
+      uint8_t least = i;
+      uint8_t l = 2 * i + 1, r = 2 * i + 2;
+      if (l < heapLen_ && before(jobs_[heap_[l]].dueMs, jobs_[heap_[least]].dueMs)) least = l;
+      if (r < heapLen_ && before(jobs_[heap_[r]].dueMs, jobs_[heap_[least]].dueMs)) least = r;
+      if (least == i) return;
+      swap(i, least);
+      i = least;
+    }
+  }
+
+  Job jobs_[N] = {};
+  uint8_t heap_[N] = {};
+  uint8_t count_ = 0;
+  uint8_t heapLen_ = 0;
+  uint32_t pass_ = 0;
+  uint32_t lateMs_ = 0;
+};
@@ -0,0 +1,95 @@
+#pragma once
+#include <ctype.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <strings.h>
+
+// --- Leitor de linhas sem bloqueio ---
+// Acumula os bytes que já chegaram num buffer fixo e devolve a linha quando
+// vem o '\n' ('\r' é ignorado). Nunca espera: sem linha completa, poll()
+// retorna false e continua de onde parou na próxima chamada. Linhas maiores
+// que o buffer são descartadas até o fim (takeOverflow() avisa uma vez).
+template<size_t N>
+class LineReader {
+public:
+  // Stream: qualquer tipo com available()/read() (Serial)
+  template<typename Stream>
+  bool poll(Stream& in) {
+    while (in.available() > 0) {
+      int c = in.read();
+      if (c < 0) break;
+      if (c == '\r') continue;
+      if (c == '\n') {
+        buf_[len_] = '\0';
+        lineLen_ = len_;
+        len_ = 0;
+        if (discarding_) {
+          discarding_ = false;
+          overflowed_ = true;
+          continue;
+        }
+        return true;
+      }
+      if (discarding_) continue;
+      if (len_ + 1 >= N) {
+        discarding_ = true;
+        continue;
+      }
+      buf_[len_++] = (char)c;
+    }
+    return false;
+  }
+
+  // Linha devolvida pelo último poll() == true (terminada em '\0', editável)
+  char* line() { return buf_; }
+  size_t length() const { return lineLen_; }
+  // Houve linha longa demais descartada desde a última consulta
+  bool takeOverflow() {
+    bool o = overflowed_;
+    overflowed_ = false;
+    return o;
+  }
+
+private:
+  char buf_[N];
+  size_t len_ = 0;
+  size_t lineLen_ = 0;
+  bool discarding_ = false;
+  bool overflowed_ = false;
+};
+
+// --- Despacho de comandos por tabela ---
+// O primeiro token da linha escolhe o comando (sem diferenciar maiúsculas);
+// o resto, sem espaços nas pontas, vai como args ("" se não houver).
+struct SerialCommand {
+  const char* name;
+  void (*handler)(const char* args);
+  const char* help;
+};
+
+inline char* trimInPlace(char* s) {
+  while (*s && isspace((unsigned char)*s)) s++;
+  char* end = s;
+  for (char* p = s; *p; p++) {
+    if (!isspace((unsigned char)*p)) end = p + 1;
+  }
+  *end = '\0';
+  return s;
+}
+
+// Devolve false se a linha não estava vazia e nenhum comando bateu
+inline bool dispatchCommand(const SerialCommand* table, size_t count, char* line) {
+  char* cmd = trimInPlace(line);
+  if (*cmd == '\0') return true;
+  char* args = cmd;
+  while (*args && !isspace((unsigned char)*args)) args++;
+  if (*args) *args++ = '\0';
+  args = trimInPlace(args);
+  for (size_t i = 0; i < count; i++) {
+    if (strcasecmp(cmd, table[i].name) == 0) {
+      table[i].handler(args);
+      return true;
+    }
+  }
+  return false;
+}
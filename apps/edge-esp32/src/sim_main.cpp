@@ -0,0 +1,114 @@
+// --- Execução no host ---
+// Programa do ambiente native (fora do pio test) com um cenário simples:
+//   program [segundos] [t_ms:COMANDO ...]
+// ex.: program 120 0:OFFLINE 60000:ONLINE 90000:!DROP
+// Batimentos a 75 bpm no botão e o consumidor simulado (test/sim_consumer.h)
+// confirmando os envelopes. O loop() dorme no relógio virtual até o
+// próximo prazo ou evento; uma iteração que não dormiu conta 1 ms.
+// COMANDO vai para o Serial; !DROP derruba a conexão MQTT, !MQTT_DOWN /
+// !MQTT_UP deixam o broker indisponível / disponível e !TEMP=<°C> /
+// !BPM=<n> mudam o DHT e o ritmo dos batimentos (SIM_ALERT mede quanto o
+// alerta leva para chegar). t_ms conta do início;
+// CARDIOIA_SIM_START_MS põe o relógio perto da volta do millis() (ex.:
+// 4294957296 = 10 s antes). DHT22 no GPIO 15: CARDIOIA_SIM_DHT_WAVE=<arquivo>
+// reproduz formas de onda gravadas, CARDIOIA_SIM_DHT_JITTER_US e
+// CARDIOIA_SIM_DHT_MISS_PCT (ex.: 0.5) degradam o sinal.
+// CARDIOIA_SIM_NOINIT=<arquivo> faz o papel da RAM retida entre "resets";
+// CARDIOIA_SIM_NOINIT_FLIP=<offset> inverte um byte ao carregar.
+#if !defined(ARDUINO) && !defined(PIO_UNIT_TESTING)
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "hal_native.h"
+#include "sim_consumer.h"
+
+void setup();
+void loop();
+
+static const uint8_t SIM_PIN_BTN = 4;
+static const uint8_t SIM_PIN_DHT = 15;
+
+int main(int argc, char** argv) {
+  uint32_t seconds = argc > 1 ? (uint32_t)strtoul(argv[1], nullptr, 10) : 60;
+  struct Cmd { uint32_t atMs; const char* text; };
+  std::vector<Cmd> cmds;
+  for (int i = 2; i < argc; i++) {
+    const char* colon = strchr(argv[i], ':');
+    if (!colon) continue;
+    cmds.push_back(Cmd{(uint32_t)strtoul(argv[i], nullptr, 10), colon + 1});
+  }
+
+  // Custos do connect MQTT (DNS + TCP + TLS) e de cada PUBLISH, para medir o
+  // impacto no loop
+  if (const char* ms = getenv("CARDIOIA_SIM_MQTT_CONNECT_MS")) {
+    sim::setMqttConnectCostUs((uint32_t)strtoul(ms, nullptr, 10) * 1000);
+  }
+  if (const char* us = getenv("CARDIOIA_SIM_MQTT_PUBLISH_US")) {
+    sim::setMqttPublishCostUs((uint32_t)strtoul(us, nullptr, 10));
+  }
+  if (const char* ms = getenv("CARDIOIA_SIM_LINK_DELAY_MS")) {
+    sim::setLinkDelayUs((uint32_t)strtoul(ms, nullptr, 10) * 1000);
+  }
+  if (const char* ack = getenv("CARDIOIA_SIM_ACK")) simConsumer.ack = atoi(ack) != 0;
+  // DHT22 na linha: formas de onda gravadas, jitter por nível e bordas que
+  // a ISR perde, para medir o decodificador da leitura assíncrona
+  sim::attachDht(SIM_PIN_DHT);
+  if (const char* path = getenv("CARDIOIA_SIM_DHT_WAVE")) {
+    if (!sim::loadDhtWaveforms(path)) fprintf(stderr, "CARDIOIA_SIM_DHT_WAVE: não abriu %s\n", path);
+  }
+  if (const char* us = getenv("CARDIOIA_SIM_DHT_JITTER_US")) {
+    sim::setDhtJitterUs((uint32_t)strtoul(us, nullptr, 10));
+  }
+  if (const char* pct = getenv("CARDIOIA_SIM_DHT_MISS_PCT")) sim::setDhtMissPct(atof(pct));
+  sim::onBrokerReceive(simConsumerReceive);
+  if (const char* ms = getenv("CARDIOIA_SIM_START_MS")) {
+    sim::setNowUs(strtoull(ms, nullptr, 10) * 1000);
+  }
+  uint64_t startUs = sim::nowUs();
+  const char* noinit = getenv("CARDIOIA_SIM_NOINIT");
+  if (noinit) {
+    size_t n = sim::loadNoinit(noinit);
+    if (n) printf("SIM_NOINIT carregado=%zu de %zu\r\n", n, sim::noinitSize());
+  }
+  if (const char* at = getenv("CARDIOIA_SIM_NOINIT_FLIP")) {
+    sim::flipNoinitByte((size_t)strtoul(at, nullptr, 10));
+  }
+
+  setup();
+  uint64_t endUs = sim::nowUs() + (uint64_t)seconds * 1000000ULL;
+  sim::startBeats(SIM_PIN_BTN, sim::nowUs() + 400000, endUs);
+  for (const Cmd& c : cmds) {
+    const char* text = c.text;
+    sim::scheduleAt(startUs + (uint64_t)c.atMs * 1000, [text] {
+      if (strcmp(text, "!DROP") == 0) sim::dropMqtt();
+      else if (strcmp(text, "!MQTT_DOWN") == 0) sim::setMqttAvailable(false);
+      else if (strcmp(text, "!MQTT_UP") == 0) sim::setMqttAvailable(true);
+      else if (strncmp(text, "!TEMP=", 6) == 0) {
+        float temp = (float)atof(text + 6);
+        sim::setDht(temp, 55.0f);
+        simConsumer.inject(false, temp > 38.0f);
+      }
+      else if (strncmp(text, "!BPM=", 5) == 0) {
+        unsigned long bpm = strtoul(text + 5, nullptr, 10);
+        if (bpm > 0) sim::setBeatPeriodUs(60000000ULL / bpm);
+        simConsumer.inject(true, bpm > 120);
+      }
+      else sim::serialInput(text);
+    });
+  }
+  while (sim::nowUs() < endUs) {
+    uint64_t before = sim::nowUs();
+    loop();
+    if (sim::nowUs() == before) sim::advanceMs(1);
+  }
+  if (noinit) sim::saveNoinit(noinit);
+  const SimConsumer& c = simConsumer;
+  printf("\r\nSIM_END published=%zu received=%lu dup=%lu alerts=%lu windows=%lu aggs=%lu first_ts_s=%lu "
+         "alert_msgs=%lu\r\n",
+         sim::published().size(), c.samples, c.dups, c.alerts, c.windows, c.aggs,
+         c.samples ? (unsigned long)(c.firstTs / 1000) : 0UL, c.alertMsgs);
+  return 0;
+}
+
+#endif // !ARDUINO && !PIO_UNIT_TESTING
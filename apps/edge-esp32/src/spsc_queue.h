@@ -0,0 +1,56 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+// --- Fila SPSC sem lock ---
+// Um produtor e um consumidor, cada um em seu contexto (tarefa, core ou
+// ISR). Só usa loads/stores atômicos de 32 bits com acquire/release, sem
+// desabilitar interrupções nem bloquear. N deve ser potência de 2.
+// push()/pop() são always_inline para poderem ser usados de ISRs em IRAM.
+#define SPSC_INLINE inline __attribute__((always_inline))
+
+template <typename T, size_t N>
+class SpscQueue {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "N deve ser potência de 2");
+
+public:
+  // Produtor. Retorna false se cheia (o item não entra).
+  SPSC_INLINE bool push(const T& v) {
+    uint32_t head = head_.load(std::memory_order_relaxed);
+    uint32_t tail = tail_.load(std::memory_order_acquire);
+    if (head - tail == N) return false;
+    buf_[head & (N - 1)] = v;
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumidor. Retorna false se vazia.
+  SPSC_INLINE bool pop(T& out) {
+    uint32_t tail = tail_.load(std::memory_order_relaxed);
+    uint32_t head = head_.load(std::memory_order_acquire);
+    if (head == tail) return false;
+    out = buf_[tail & (N - 1)];
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumidor: o próximo item sem retirar (pop() confirma). false se vazia.
+  SPSC_INLINE bool peek(T& out) const {
+    uint32_t tail = tail_.load(std::memory_order_relaxed);
+    uint32_t head = head_.load(std::memory_order_acquire);
+    if (head == tail) return false;
+    out = buf_[tail & (N - 1)];
+    return true;
+  }
+
+  // Aproximado quando chamado fora do produtor/consumidor
+  size_t size() const {
+    return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+  }
+
+private:
+  T buf_[N];
+  std::atomic<uint32_t> head_{0};
+  std::atomic<uint32_t> tail_{0};
+};
@@ -0,0 +1,143 @@
+#pragma once
+// Consumidor simulado (como o fluxo do Node-RED), para o ambiente native:
+// confirma os envelopes {"boot","seq","base","samples"} em .../ack e conta
+// amostras únicas e duplicadas. Aceita só a sequência contígua, começando
+// em base no primeiro envelope do boot; após uma lacuna espera o reenvio.
+// Agregados contam como uma amostra com n janelas; alerta pelos máximos.
+// Usado pelos testes (test_sim) e pelo programa native (src/sim_main.cpp).
+#ifndef ARDUINO
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <set>
+#include <string>
+#include <vector>
+#include "hal_native.h"
+
+struct SimConsumer {
+  bool ack = true;
+  bool hasSeq = false;
+  uint32_t boot = 0, lastSeq = 0;
+  unsigned long samples = 0, dups = 0;
+  unsigned long gaps = 0;     // amostras depois de uma lacuna (descartadas)
+  unsigned long alerts = 0;   // únicas com temp > 38 ou bpm > 120
+  unsigned long windows = 0;  // janelas cobertas pelas únicas
+  unsigned long aggs = 0;
+  unsigned long repeats = 0;  // únicas pelo seq, mas já contadas (estado perdido)
+  std::set<uint32_t> seenTs;
+  // Janelas mais antiga e mais nova recebidas, comparadas com wrap (o ts é
+  // millis() do ESP32)
+  uint32_t firstTs = UINT32_MAX;
+  uint32_t lastTs = 0;
+  unsigned long alertMsgs = 0;     // mensagens em cardioia/ana/v1/alert
+
+  // Latência de !TEMP= / !BPM= até o consumidor ver o alerta: pelo tópico
+  // de alertas (primeira transição) e pelas amostras (primeira janela com
+  // a regra no estado esperado). UINT32_MAX enquanto não chegou.
+  uint64_t injectUs = 0;
+  bool injectBpm = false, expectAlert = false;
+  bool waitTopic = false, waitWindow = false;
+  uint32_t topicMs = UINT32_MAX, windowMs = UINT32_MAX;
+
+  void inject(bool bpm, bool alert) {
+    injectUs = sim::nowUs();
+    injectBpm = bpm;
+    expectAlert = alert;
+    waitTopic = waitWindow = true;
+    topicMs = windowMs = UINT32_MAX;
+  }
+
+  // Node-RED reiniciado: perde o estado de deduplicação
+  void restart() { hasSeq = false; }
+
+  struct Item {
+    bool alert;
+    bool fever, tachy;   // regra que deu o alerta
+    bool agg;
+    uint16_t windows;
+    uint32_t ts;
+  };
+
+  void count(const Item& it) {
+    if (!seenTs.insert(it.ts).second) repeats++;
+    if (samples == 0 || (int32_t)(it.ts - firstTs) < 0) firstTs = it.ts;
+    if (samples == 0 || (int32_t)(it.ts - lastTs) > 0) lastTs = it.ts;
+    samples++;
+    alerts += it.alert;
+    windows += it.windows;
+    aggs += it.agg;
+    bool rule = injectBpm ? it.tachy : it.fever;
+    uint32_t injectMs = (uint32_t)((injectUs + 999) / 1000);
+    if (waitWindow && rule == expectAlert && (int32_t)(it.ts - injectMs) >= 0) {
+      waitWindow = false;
+      windowMs = (uint32_t)((sim::nowUs() - injectUs) / 1000);
+      printf("SIM_ALERT via=janela ms=%lu\r\n", (unsigned long)windowMs);
+    }
+  }
+};
+
+inline SimConsumer simConsumer;
+
+inline SimConsumer::Item simParseItem(const char* p) {
+  SimConsumer::Item it{false, false, false, false, 1, 0};
+  float temp = NAN;
+  unsigned long ts = 0, bpm = 0, n = 1;
+  if (sscanf(p, "{\"ts\":%lu,\"ts_end\":%*u,\"n\":%lu", &ts, &n) == 2) {
+    it.agg = true;
+    const char* t = strstr(p, "\"temp_max\":");
+    const char* b = strstr(p, "\"bpm_max\":");
+    if (t) sscanf(t, "\"temp_max\":%f", &temp);
+    if (b) sscanf(b, "\"bpm_max\":%lu", &bpm);
+  } else {
+    sscanf(p, "{\"ts\":%lu,\"temp\":%f,\"hum\":%*f,\"bpm\":%lu", &ts, &temp, &bpm);
+  }
+  it.fever = temp > 38.0f;
+  it.tachy = bpm > 120;
+  it.alert = it.fever || it.tachy;
+  it.windows = (uint16_t)n;
+  it.ts = (uint32_t)ts;
+  return it;
+}
+
+// Gancho do broker (sim::onBrokerReceive)
+inline void simConsumerReceive(const sim::Message& msg) {
+  SimConsumer& c = simConsumer;
+  std::string p(msg.payload.begin(), msg.payload.end());
+  if (msg.topic == "cardioia/ana/v1/alert") {
+    c.alertMsgs++;
+    if (c.waitTopic) {
+      c.waitTopic = false;
+      c.topicMs = (uint32_t)((sim::nowUs() - c.injectUs) / 1000);
+      printf("SIM_ALERT via=topico ms=%lu %s\r\n", (unsigned long)c.topicMs, p.c_str());
+    }
+    return;
+  }
+  if (msg.topic != "cardioia/ana/v1/vitals") return;
+  std::vector<SimConsumer::Item> items;
+  for (size_t at = p.find("{\"ts\":"); at != std::string::npos; at = p.find("{\"ts\":", at + 1)) {
+    items.push_back(simParseItem(p.c_str() + at));
+  }
+  unsigned long n = items.size();
+  unsigned long boot, seq, base = 0;
+  if (sscanf(p.c_str(), "{\"boot\":%lu,\"seq\":%lu,\"base\":%lu", &boot, &seq, &base) < 2) {
+    for (const SimConsumer::Item& it : items) c.count(it);  // QoS 0 sem envelope
+    return;
+  }
+  if (!c.hasSeq || c.boot != boot) {
+    c.hasSeq = true;
+    c.boot = (uint32_t)boot;
+    c.lastSeq = (uint32_t)base - 1;
+  }
+  for (unsigned long i = 0; i < n; i++) {
+    uint32_t s = (uint32_t)(seq + i);
+    if ((int32_t)(s - c.lastSeq) <= 0) c.dups++;
+    else if (s == c.lastSeq + 1) { c.count(items[i]); c.lastSeq = s; }
+    else c.gaps++;
+  }
+  if (!c.ack) return;
+  char buf[48];
+  snprintf(buf, sizeof(buf), "{\"boot\":%lu,\"seq\":%lu}", (unsigned long)c.boot, (unsigned long)c.lastSeq);
+  sim::deliver("cardioia/ana/v1/vitals/ack", buf);
+}
+
+#endif // !ARDUINO
@@ -0,0 +1,105 @@
+// BeatTracker / IbiEwma (beat_tracker.h): precisão do BPM em trens de
+// batimentos sintéticos, com jitter, bounce e a volta do micros().
+#include <unity.h>
+#include <random>
+#include "beat_tracker.h"
+
+static const uint32_t WINDOW_US = 10000000;     // como BPM_SLIDING_WINDOW_MS
+static const uint32_t REFRACTORY_US = 200000;   // como BEAT_REFRACTORY_MS
+
+void setUp() {}
+void tearDown() {}
+
+// Ritmo constante: o BPM sai exato, sem os degraus de 6 de pulsos * 6
+void test_steady_train_is_exact() {
+  const float rates[] = {45.0f, 60.0f, 72.5f, 75.0f, 97.0f, 121.0f, 180.0f};
+  for (float rate : rates) {
+    BeatTracker<64> t(WINDOW_US, REFRACTORY_US);
+    uint32_t ibi = (uint32_t)(60e6f / rate + 0.5f);
+    uint32_t now = 1000;
+    for (int i = 0; i < 40; i++, now += ibi) t.addBeat(now);
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, rate, t.bpm(now - ibi));
+    TEST_ASSERT_EQUAL_UINT32(ibi, t.lastIbiUs());
+  }
+}
+
+// Jitter gaussiano de 10 ms por batimento: média da janela perto do ritmo
+void test_jittered_train_within_one_bpm() {
+  std::mt19937 rng(3);
+  std::normal_distribution<float> jitter(0.0f, 10000.0f);
+  for (float rate = 50.0f; rate <= 150.0f; rate += 10.0f) {
+    BeatTracker<64> t(WINDOW_US, REFRACTORY_US);
+    double ideal = 1000;
+    float worst = 0;
+    for (int i = 0; i < 200; i++) {
+      ideal += 60e6 / rate;
+      uint32_t at = (uint32_t)(ideal + jitter(rng));
+      t.addBeat(at);
+      if (i >= 20) {
+        float err = t.bpm(at) - rate;
+        if (err < 0) err = -err;
+        if (err > worst) worst = err;
+      }
+    }
+    TEST_ASSERT_LESS_THAN_FLOAT(1.0f, worst);
+  }
+}
+
+// Bounce do botão (bordas a poucos ms) cai no período refratário
+void test_bounce_is_rejected() {
+  BeatTracker<64> t(WINDOW_US, REFRACTORY_US);
+  uint32_t now = 0;
+  for (int i = 0; i < 20; i++, now += 800000) {
+    TEST_ASSERT_TRUE(t.addBeat(now));
+    TEST_ASSERT_FALSE(t.addBeat(now + 3000));
+    TEST_ASSERT_FALSE(t.addBeat(now + 150000));
+  }
+  TEST_ASSERT_EQUAL_UINT32(20, t.totalBeats());
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 75.0f, t.bpm(now - 800000));
+}
+
+// Janela deslizante: batimentos velhos saem e uma pausa zera o BPM
+void test_window_expires_old_beats() {
+  BeatTracker<64> t(WINDOW_US, REFRACTORY_US);
+  uint32_t now = 0;
+  for (int i = 0; i < 30; i++, now += 1000000) t.addBeat(now);   // 60 bpm
+  for (int i = 0; i < 30; i++, now += 500000) t.addBeat(now);    // 120 bpm
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 120.0f, t.bpm(now - 500000));
+  TEST_ASSERT_LESS_OR_EQUAL(21, t.beats());
+  TEST_ASSERT_FLOAT_WITHIN(0.0f, 0.0f, t.bpm(now + 2 * WINDOW_US));
+  TEST_ASSERT_EQUAL(0, t.beats());
+}
+
+// micros() dá a volta (~71 min) no meio do trem
+void test_micros_wrap() {
+  BeatTracker<64> t(WINDOW_US, REFRACTORY_US);
+  uint32_t now = UINT32_MAX - 5000000;
+  for (int i = 0; i < 30; i++, now += 750000) t.addBeat(now);   // 80 bpm
+  TEST_ASSERT_LESS_THAN(UINT32_MAX - 5000000, now);   // voltou
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 80.0f, t.bpm(now - 750000));
+}
+
+// Streaming: um salto de 75 para 150 bpm aparece em poucos batimentos
+void test_ewma_step_response() {
+  IbiEwma e(1);
+  for (int i = 0; i < 10; i++) e.addIbi(800000);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 75.0f, e.bpm());
+  e.addIbi(400000);
+  e.addIbi(400000);
+  TEST_ASSERT_GREATER_THAN_FLOAT(115.0f, e.bpm());
+  for (int i = 0; i < 20; i++) e.addIbi(400000);
+  TEST_ASSERT_FLOAT_WITHIN(0.5f, 150.0f, e.bpm());
+  e.reset();
+  TEST_ASSERT_FLOAT_WITHIN(0.0f, 0.0f, e.bpm());
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_steady_train_is_exact);
+  RUN_TEST(test_jittered_train_within_one_bpm);
+  RUN_TEST(test_bounce_is_rejected);
+  RUN_TEST(test_window_expires_old_beats);
+  RUN_TEST(test_micros_wrap);
+  RUN_TEST(test_ewma_step_response);
+  return UNITY_END();
+}
@@ -0,0 +1,527 @@
+// Benchmarks em tempo real do host, com o resultado conferido: os números
+// (BENCH_*) saem no log do pio test, o teste falha se a saída estiver
+// errada ou se o formato compacto deixar de compensar.
+#include <unity.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <chrono>
+#include <new>
+#include <random>
+#include <vector>
+#include "beat_tracker.h"
+#include "flash_log.h"
+#include "log_storage.h"
+#include "sample.h"
+#include "sample_agg.h"
+#include "sample_block.h"
+#include "sample_json.h"
+#include "sample_queue.h"
+#include "sample_stats.h"
+
+typedef std::chrono::steady_clock Clock;
+
+// --- Alocações no heap ---
+// Conta todo new do binário e as alocações da LegacyString: o caminho novo
+// tem de sair com zero.
+static size_t heapAllocs = 0;
+
+void* operator new(size_t n) {
+  heapAllocs++;
+  void* p = malloc(n ? n : 1);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+// --- String do core Arduino (WString), para o caminho antigo ---
+// Até 11 caracteres no próprio objeto (SSO do core ESP32); acima disso um
+// buffer no heap, realocado no tamanho exato sempre que a concatenação não
+// cabe. Atribuir a uma String com capacidade suficiente só copia.
+class LegacyString {
+public:
+  LegacyString() { sso_[0] = 0; }
+  LegacyString(const char* s) : LegacyString() { concat(s, strlen(s)); }
+  LegacyString(float v, int decimals) : LegacyString() {
+    char b[33];   // dtostrf() num buffer da pilha, como o String(float, 2)
+    concat(b, (size_t)snprintf(b, sizeof(b), "%.*f", decimals, (double)v));
+  }
+  LegacyString(const LegacyString& o) : LegacyString() { concat(o.c_str(), o.len_); }
+  LegacyString(LegacyString&& o) noexcept : heap_(o.heap_), len_(o.len_), cap_(o.cap_) {
+    memcpy(sso_, o.sso_, sizeof(sso_));
+    o.heap_ = nullptr;
+    o.len_ = 0;
+    o.cap_ = SSO;
+    o.sso_[0] = 0;
+  }
+  ~LegacyString() { free(heap_); }
+
+  LegacyString& operator=(const LegacyString& o) {
+    if (this != &o) {
+      len_ = 0;
+      concat(o.c_str(), o.len_);
+    }
+    return *this;
+  }
+  LegacyString& operator+=(const char* s) { return concat(s, strlen(s)); }
+  LegacyString& operator+=(const LegacyString& o) { return concat(o.c_str(), o.len_); }
+  LegacyString& operator+=(uint32_t v) {
+    char b[11];
+    return concat(b, (size_t)snprintf(b, sizeof(b), "%lu", (unsigned long)v));
+  }
+  LegacyString& operator+=(int v) {
+    char b[12];
+    return concat(b, (size_t)snprintf(b, sizeof(b), "%d", v));
+  }
+
+  const char* c_str() const { return heap_ ? heap_ : sso_; }
+  size_t length() const { return len_; }
+  // RAM da fila antiga por entrada no ESP32: o objeto String (16 bytes no
+  // core de 32 bits) mais o buffer no heap, sem o cabeçalho do alocador
+  size_t ramBytes() const { return 16 + (heap_ ? cap_ + 1 : 0); }
+
+private:
+  static const size_t SSO = 11;
+
+  LegacyString& concat(const char* s, size_t n) {
+    if (len_ + n > cap_) {
+      char* p = (char*)realloc(heap_, len_ + n + 1);
+      heapAllocs++;
+      if (!heap_) memcpy(p, sso_, len_ + 1);
+      heap_ = p;
+      cap_ = len_ + n;
+    }
+    char* d = heap_ ? heap_ : sso_;
+    memcpy(d + len_, s, n);
+    len_ += n;
+    d[len_] = 0;
+    return *this;
+  }
+
+  char* heap_ = nullptr;
+  size_t len_ = 0, cap_ = SSO;
+  char sso_[SSO + 1];
+};
+
+// O makeSampleJson() antigo, linha por linha
+static LegacyString legacyMakeSampleJson(uint32_t ts, float temp, float hum, int bpm, bool connected) {
+  LegacyString s = "{";
+  s += "\"ts\":"; s += ts;
+  s += ",\"temp\":"; s += LegacyString(temp, 2);
+  s += ",\"hum\":"; s += LegacyString(hum, 2);
+  s += ",\"bpm\":"; s += bpm;
+  s += ",\"connected\":"; s += (connected ? "true" : "false");
+  s += "}";
+  return s;
+}
+
+static double nsSince(Clock::time_point t0) {
+  return std::chrono::duration<double, std::nano>(Clock::now() - t0).count();
+}
+
+void setUp() {}
+void tearDown() {}
+
+// Blocos comprimidos (sample_block.h): janelas com deriva parecida com a do
+// DHT22 e do BPM, codificadas e lidas de volta bloco a bloco. Compara o
+// tamanho com a SampleQueue e o JSON.
+void test_bench_blocks() {
+  static const size_t N = 100000;
+  typedef SampleBlockLog<60, 256> Blocks;
+  static Blocks blocks(10000);
+  std::mt19937 rng(1);
+  std::vector<Sample> in(N);
+  int temp = 3650, hum = 5500, bpm = 75;
+  uint32_t ts = 10000;
+  size_t jsonBytes = 0;
+  char line[SAMPLE_JSON_MAX];
+  for (size_t i = 0; i < N; i++) {
+    temp += (int)(rng() % 3) * 10 - 10;        // passos de 0,1 °C
+    hum += (int)(rng() % 5) * 10 - 20;
+    bpm += (int)(rng() % 5) - 2;
+    if (bpm < 50) bpm = 50;
+    if (bpm > 150) bpm = 150;
+    ts += rng() % 16 == 0 ? 10001 : 10000;      // janela atrasada de vez em quando
+    in[i] = makeSample(ts, temp / 100.0f, hum / 100.0f, bpm, false);
+    jsonBytes += formatSampleJson(line, sizeof(line), in[i]);
+  }
+  double encNs = 0, decNs = 0;
+  size_t bytes = 0, samples = 0, errors = 0;
+  Sample out;
+  for (size_t at = 0; at < N;) {
+    // Enche os blocos, mede, e esvazia lendo tudo de volta
+    size_t start = at;
+    Clock::time_point t0 = Clock::now();
+    while (at < N && !blocks.full()) blocks.push(in[at++]);
+    Clock::time_point t1 = Clock::now();
+    bytes += blocks.bytesUsed();
+    samples += blocks.size();
+    for (size_t i = start; i < at; i++) {
+      if (!blocks.peek(out) || memcmp(&out, &in[i], sizeof(out)) != 0) errors++;
+      blocks.pop();
+    }
+    Clock::time_point t2 = Clock::now();
+    encNs += std::chrono::duration<double, std::nano>(t1 - t0).count();
+    decNs += std::chrono::duration<double, std::nano>(t2 - t1).count();
+  }
+  double perSample = (double)bytes / (double)samples;
+  printf("BENCH_BLOCKS amostras=%zu bytes_amostra=%.2f fila=%zu json=%.1f cabem=%zu encode_ns=%.1f "
+         "decode_ns=%.1f erros=%zu\r\n",
+         N, perSample, sizeof(Sample), (double)jsonBytes / (double)N,
+         (size_t)(Blocks::capacityBytes() / perSample), encNs / (double)N, decNs / (double)N, errors);
+  TEST_ASSERT_EQUAL(0, errors);
+  TEST_ASSERT_EQUAL(N, samples);
+  TEST_ASSERT_EQUAL(0, blocks.size());
+  TEST_ASSERT_LESS_THAN_MESSAGE(sizeof(Sample) / 2.0, perSample, "bytes por amostra nos blocos");
+}
+
+// Resumo por janela (sample_stats.h): custo por evento dos acumuladores e
+// do fechamento, e o resultado em ponto fixo contra o cálculo em duas
+// passadas (double). Janelas de 10 s: 12 IBIs e 5 leituras do DHT.
+void test_bench_stats() {
+  static const size_t WINDOWS = 100000, IBIS = 12, DHTS = 5;
+  std::mt19937 rng(1);
+  std::normal_distribution<float> ibiNoise(0.0f, 40000.0f), tempNoise(0.0f, 0.05f), humNoise(0.0f, 0.8f);
+  std::vector<uint32_t> ibis(WINDOWS * IBIS);
+  std::vector<float> temps(WINDOWS * DHTS), hums(WINDOWS * DHTS);
+  for (size_t i = 0; i < ibis.size(); i++) ibis[i] = (uint32_t)(800000.0f + ibiNoise(rng));
+  for (size_t i = 0; i < temps.size(); i++) {
+    temps[i] = 36.5f + tempNoise(rng);
+    hums[i] = 55.0f + humNoise(rng);
+  }
+  WindowStats w;
+  volatile float sink = 0;
+  Clock::time_point t0 = Clock::now();
+  for (size_t i = 0; i < ibis.size(); i++) {
+    w.ibi.add(ibis[i]);
+    if (i % IBIS == IBIS - 1) w.ibi.resetWindow();
+  }
+  sink = sink + w.ibi.sumSqDiff;
+  Clock::time_point t1 = Clock::now();
+  for (size_t i = 0; i < temps.size(); i++) {
+    w.addDht(temps[i], hums[i]);
+    if (i % DHTS == DHTS - 1) { w.temp.reset(); w.hum.reset(); }
+  }
+  sink = sink + w.temp.m2;
+  Clock::time_point t2 = Clock::now();
+  std::vector<SampleStats> out(WINDOWS);
+  w = WindowStats();
+  for (size_t k = 0; k < WINDOWS; k++) {
+    for (size_t i = 0; i < IBIS; i++) w.ibi.add(ibis[k * IBIS + i]);
+    for (size_t i = 0; i < DHTS; i++) w.addDht(temps[k * DHTS + i], hums[k * DHTS + i]);
+    out[k] = w.close();
+  }
+  Clock::time_point t3 = Clock::now();
+  (void)sink;
+
+  // Referência: duas passadas em double, arredondada como o firmware
+  size_t errors = 0;
+  uint32_t prev = 0;
+  for (size_t k = 0; k < WINDOWS; k++) {
+    const uint32_t* x = &ibis[k * IBIS];
+    double mean = 0, var = 0, sq = 0, tm = 0, tv = 0;
+    size_t diffs = 0;
+    for (size_t i = 0; i < IBIS; i++) mean += x[i] / (double)IBIS;
+    for (size_t i = 0; i < IBIS; i++) var += (x[i] - mean) * (x[i] - mean) / (IBIS - 1);
+    for (size_t i = 0; i < IBIS; i++) {
+      if (prev) { sq += ((double)x[i] - prev) * ((double)x[i] - prev); diffs++; }
+      prev = x[i];
+    }
+    const float* t = &temps[k * DHTS];
+    for (size_t i = 0; i < DHTS; i++) tm += t[i] / (double)DHTS;
+    for (size_t i = 0; i < DHTS; i++) tv += (t[i] - tm) * (t[i] - tm) / (DHTS - 1);
+    long sdnn = lround(sqrt(var) / 100.0), rmssd = lround(sqrt(sq / diffs) / 100.0);
+    long tempMean = lround(tm * 100.0), tempSd = lround(sqrt(tv) * 100.0);
+    const SampleStats& o = out[k];
+    if (labs(o.sdnn - sdnn) > 1 || labs(o.rmssd - rmssd) > 1 || labs(o.tempMean - tempMean) > 1 ||
+        labs(o.tempSd - tempSd) > 1 || o.ibiN != IBIS || o.dhtN != DHTS) {
+      errors++;
+    }
+  }
+  double ibiNs = std::chrono::duration<double, std::nano>(t1 - t0).count() / (double)ibis.size();
+  double dhtNs = std::chrono::duration<double, std::nano>(t2 - t1).count() / (double)temps.size();
+  double windowNs = std::chrono::duration<double, std::nano>(t3 - t2).count() / (double)WINDOWS;
+  char json[RECORD_JSON_MAX];
+  size_t jsonLen = formatRecordJson(json, sizeof(json), sampleRecord(makeSample(0, 36.5f, 55.0f, 75, true), out[0]));
+  printf("BENCH_STATS janelas=%zu ibi_ns=%.1f dht_ns=%.1f janela_ns=%.1f fechamento_ns=%.1f json=%zu "
+         "erros=%zu\r\n",
+         WINDOWS, ibiNs, dhtNs, windowNs, windowNs - IBIS * ibiNs - DHTS * dhtNs, jsonLen, errors);
+  TEST_ASSERT_EQUAL(0, errors);
+  TEST_ASSERT_GREATER_THAN(0, jsonLen);
+}
+
+// Log em flash (flash_log.h) sobre arquivos do host: enche os 64 segmentos
+// em lotes do spill (32), mede a recuperação no boot com o log cheio e
+// esvazia em lotes do flush (60) com commit a cada lote. Bytes gravados por
+// amostra confirmada incluem os metadados de cada rotação e commit.
+void test_bench_flash_log() {
+  static const size_t N = FLASH_LOG_SEG_RECORDS * FLASH_LOG_MAX_SEGMENTS;
+  static const size_t SPILL = 32, FLUSH = 60, BOOTS = 20;
+  char root[] = "/tmp/bench_flash_XXXXXX";
+  TEST_ASSERT_NOT_NULL(mkdtemp(root));
+  PosixLogStorage st(root);
+  TEST_ASSERT_TRUE(st.begin());
+  std::vector<Sample> in(N);
+  for (size_t i = 0; i < N; i++) in[i] = makeSample(10000 + i * 10000, 36.5f, 55.0f, 60 + (int)(i % 40), false);
+
+  FlashLog log(st);
+  TEST_ASSERT_TRUE(log.begin());
+  Clock::time_point t0 = Clock::now();
+  for (size_t at = 0; at < N; at += SPILL) TEST_ASSERT_TRUE(log.append(&in[at], SPILL));
+  Clock::time_point t1 = Clock::now();
+  TEST_ASSERT_EQUAL(0, log.dropped());
+
+  // Reboot com o log cheio: só metadados e um stat por segmento
+  uint32_t readBefore = st.bytesRead;
+  double bootUs = 0;
+  for (size_t b = 0; b < BOOTS; b++) {
+    FlashLog again(st);
+    Clock::time_point b0 = Clock::now();
+    TEST_ASSERT_TRUE(again.begin());
+    bootUs += std::chrono::duration<double, std::micro>(Clock::now() - b0).count();
+    TEST_ASSERT_EQUAL(N, again.size());
+  }
+  uint32_t bootRead = (st.bytesRead - readBefore) / BOOTS;
+
+  size_t errors = 0, committed = 0;
+  Sample out;
+  Clock::time_point t2 = Clock::now();
+  while (log.size() > 0) {
+    for (size_t i = 0; i < FLUSH && log.peek(out); i++, committed++) {
+      if (memcmp(&out, &in[committed], sizeof(out)) != 0) errors++;
+      log.pop();
+    }
+    log.commit();
+  }
+  Clock::time_point t3 = Clock::now();
+  FlashLog after(st);
+  TEST_ASSERT_TRUE(after.begin());
+  TEST_ASSERT_EQUAL(0, after.size());
+  char meta[64];
+  snprintf(meta, sizeof(meta), "%s/meta.bin", root);
+  remove(meta);
+  rmdir(root);
+
+  printf("BENCH_FLASH amostras=%zu segmentos=%zu registro=%zu bytes_amostra=%.2f append_ns=%.1f "
+         "drena_ns=%.1f recuperacao_us=%.1f recuperacao_lidos=%lu erros=%zu\r\n",
+         N, FLASH_LOG_MAX_SEGMENTS, FlashLog::RECORD_SIZE, (double)st.bytesWritten / (double)committed,
+         std::chrono::duration<double, std::nano>(t1 - t0).count() / (double)N,
+         std::chrono::duration<double, std::nano>(t3 - t2).count() / (double)N, bootUs / BOOTS,
+         (unsigned long)bootRead, errors);
+  TEST_ASSERT_EQUAL(0, errors);
+  TEST_ASSERT_EQUAL(N, committed);
+  // Registro + metadados amortizados: menos de 10 % acima do registro
+  TEST_ASSERT_LESS_THAN_MESSAGE(FlashLog::RECORD_SIZE * 1.1, (double)st.bytesWritten / (double)committed,
+                                "bytes gravados por amostra confirmada");
+  TEST_ASSERT_LESS_OR_EQUAL_MESSAGE(64, bootRead, "bytes lidos na recuperação");
+}
+
+// Fila offline (sample_queue.h) contra a String ramQueue[200] antiga, pelo
+// caminho inteiro: na antiga o JSON era montado na janela e copiado para o
+// anel; na nova entra a Sample de 11 bytes e o JSON sai no flush. Períodos
+// offline de 200 janelas (a capacidade antiga), drenados por completo; as
+// duas filas têm de publicar o mesmo texto.
+void test_bench_queue() {
+  static const size_t OLD_MAX = 200, NEW_MAX = 1440, OUTAGES = 1000;
+  static LegacyString oldQueue[OLD_MAX];
+  static SampleQueue<NEW_MAX> newQueue;
+  std::mt19937 rng(1);
+  std::vector<Sample> in(OLD_MAX * OUTAGES);
+  int temp = 3650, hum = 5500, bpm = 75;
+  for (size_t i = 0; i < in.size(); i++) {
+    temp += (int)(rng() % 3) * 10 - 10;
+    hum += (int)(rng() % 5) * 10 - 20;
+    bpm = 60 + (int)(rng() % 60);
+    in[i] = makeSample(10000 + (uint32_t)i * 10000, temp / 100.0f, hum / 100.0f, bpm, false);
+  }
+  double oldEnqNs = 0, oldDeqNs = 0, newEnqNs = 0, newDeqNs = 0;
+  size_t oldAllocs = 0, newAllocs = 0, oldRam = 0, errors = 0;
+  size_t oldHead = 0, oldTail = 0, oldCount = 0;
+  static char oldOut[OLD_MAX][SAMPLE_JSON_MAX], newOut[OLD_MAX][SAMPLE_JSON_MAX];
+  char line[SAMPLE_JSON_MAX];
+  size_t sink = 0;
+  for (size_t k = 0; k < OUTAGES; k++) {
+    const Sample* batch = &in[k * OLD_MAX];
+    // Antiga: makeSampleJson() + ramEnqueue(); ramFlushPublish() copia a linha
+    size_t a0 = heapAllocs;
+    Clock::time_point t0 = Clock::now();
+    for (size_t i = 0; i < OLD_MAX; i++) {
+      const Sample& x = batch[i];
+      LegacyString json = legacyMakeSampleJson(x.ts, sampleTemp(x), sampleHum(x), x.bpm, false);
+      oldQueue[oldHead] = json;
+      oldHead = (oldHead + 1) % OLD_MAX;
+      oldCount++;
+    }
+    oldEnqNs += nsSince(t0);
+    if (k == 0) {
+      for (size_t i = 0; i < OLD_MAX; i++) oldRam += oldQueue[i].ramBytes();
+    }
+    t0 = Clock::now();
+    for (size_t i = 0; oldCount > 0; i++) {
+      LegacyString l = oldQueue[oldTail];
+      oldTail = (oldTail + 1) % OLD_MAX;
+      oldCount--;
+      sink += l.length();
+      if (k == 0) snprintf(oldOut[i], SAMPLE_JSON_MAX, "%s", l.c_str());
+    }
+    oldDeqNs += nsSince(t0);
+    oldAllocs += heapAllocs - a0;
+
+    // Nova: push da Sample; o flush monta o JSON no buffer da pilha
+    a0 = heapAllocs;
+    t0 = Clock::now();
+    for (size_t i = 0; i < OLD_MAX; i++) newQueue.push(batch[i]);
+    newEnqNs += nsSince(t0);
+    Sample x;
+    t0 = Clock::now();
+    for (size_t i = 0; newQueue.peek(x); i++) {
+      size_t n = formatSampleJson(line, sizeof(line), x);
+      newQueue.pop();
+      sink += n;
+      if (k == 0) memcpy(newOut[i], line, n + 1);
+    }
+    newDeqNs += nsSince(t0);
+    newAllocs += heapAllocs - a0;
+    if (k == 0) {
+      for (size_t i = 0; i < OLD_MAX; i++) errors += strcmp(oldOut[i], newOut[i]) != 0;
+    }
+  }
+  const double n = (double)in.size();
+  const double newRam = (double)sizeof(newQueue) / NEW_MAX;
+  printf("BENCH_QUEUE amostras=%zu bytes_amostra_antiga=%.1f bytes_amostra_nova=%.1f enqueue_ns_antiga=%.1f "
+         "enqueue_ns_nova=%.1f dequeue_ns_antiga=%.1f dequeue_ns_nova=%.1f alocs_amostra_antiga=%.2f "
+         "alocs_amostra_nova=%.2f erros=%zu\r\n",
+         in.size(), (double)oldRam / OLD_MAX, newRam, oldEnqNs / n, newEnqNs / n, oldDeqNs / n, newDeqNs / n,
+         (double)oldAllocs / n, (double)newAllocs / n, errors);
+  TEST_ASSERT_GREATER_THAN(0, sink);
+  TEST_ASSERT_EQUAL(0, errors);
+  TEST_ASSERT_EQUAL(0, newAllocs);
+  TEST_ASSERT_GREATER_THAN(0, oldAllocs);
+  // Pelo menos 4x mais amostras na mesma RAM
+  TEST_ASSERT_LESS_THAN_MESSAGE((double)oldRam / OLD_MAX / 4, newRam, "bytes por amostra na fila");
+}
+
+// JSON de uma janela: formatSampleJson() num buffer da pilha contra o
+// makeSampleJson() antigo (String += e String(float, 2)). As duas saídas
+// têm de ser iguais byte a byte.
+void test_bench_json() {
+  static const size_t N = 200000;
+  std::mt19937 rng(1);
+  std::vector<Sample> in(N);
+  for (size_t i = 0; i < N; i++) {
+    int temp = 3400 + (int)(rng() % 60) * 10, hum = 4000 + (int)(rng() % 300) * 10;
+    in[i] = makeSample(10000 + (uint32_t)i * 10000, temp / 100.0f, hum / 100.0f, 50 + (int)(rng() % 100), i % 3 == 0);
+  }
+  static char line[SAMPLE_JSON_MAX];
+  size_t oldBytes = 0, newBytes = 0, errors = 0;
+  size_t a0 = heapAllocs;
+  Clock::time_point t0 = Clock::now();
+  for (size_t i = 0; i < N; i++) {
+    const Sample& x = in[i];
+    LegacyString json = legacyMakeSampleJson(x.ts, sampleTemp(x), sampleHum(x), x.bpm, sampleConnected(x));
+    oldBytes += json.length();
+  }
+  double oldNs = nsSince(t0) / N;
+  size_t oldAllocs = heapAllocs - a0;
+  a0 = heapAllocs;
+  t0 = Clock::now();
+  for (size_t i = 0; i < N; i++) newBytes += formatSampleJson(line, sizeof(line), in[i]);
+  double newNs = nsSince(t0) / N;
+  size_t newAllocs = heapAllocs - a0;
+  for (size_t i = 0; i < N; i += 97) {
+    const Sample& x = in[i];
+    LegacyString json = legacyMakeSampleJson(x.ts, sampleTemp(x), sampleHum(x), x.bpm, sampleConnected(x));
+    formatSampleJson(line, sizeof(line), x);
+    errors += strcmp(json.c_str(), line) != 0;
+  }
+  printf("BENCH_JSON amostras=%zu ns_antigo=%.1f ns_novo=%.1f alocs_antigo=%.2f alocs_novo=%.2f bytes=%.1f "
+         "erros=%zu\r\n",
+         N, oldNs, newNs, (double)oldAllocs / N, (double)newAllocs / N, (double)newBytes / N, errors);
+  TEST_ASSERT_EQUAL(0, errors);
+  TEST_ASSERT_EQUAL(oldBytes, newBytes);
+  TEST_ASSERT_EQUAL(0, newAllocs);
+  TEST_ASSERT_LESS_THAN_MESSAGE(oldNs, newNs, "ns por amostra");
+}
+
+// Batimentos (beat_tracker.h): custo por batimento do caminho do
+// pollBeats() (addBeat, último IBI e as duas médias IbiEwma do streaming e
+// do alerta) e do bpm() no fechamento da janela de 10 s. Ritmo em passeio
+// aleatório entre 50 e 150 bpm, com jitter e bordas de bounce que o
+// refratário tem de recusar.
+void test_bench_beats() {
+  static const size_t BEATS = 500000;
+  std::mt19937 rng(9);
+  std::normal_distribution<float> jitter(0.0f, 8000.0f);
+  std::vector<uint32_t> edges;
+  edges.reserve(BEATS + BEATS / 10);
+  size_t bounces = 0;
+  double rate = 75.0, t = 1000;
+  for (size_t i = 0; i < BEATS; i++) {
+    rate += (double)((int)(rng() % 3) - 1) * 0.5;
+    rate = rate < 50 ? 50 : rate > 150 ? 150 : rate;
+    t += 60e6 / rate;
+    uint32_t at = (uint32_t)(t + jitter(rng));
+    edges.push_back(at);
+    if (rng() % 20 == 0) {
+      edges.push_back(at + 30000);   // bounce dentro dos 200 ms
+      bounces++;
+    }
+  }
+  BeatTracker<64> beats(10000000, 200000);
+  IbiEwma fast(1), alert(2);
+  volatile float sink = 0;
+  size_t rejected = 0;
+  uint32_t sum = 0;
+  Clock::time_point t0 = Clock::now();
+  for (uint32_t e : edges) {
+    if (!beats.addBeat(e)) {
+      rejected++;
+      continue;
+    }
+    uint32_t ibi = beats.lastIbiUs();
+    if (ibi == 0) continue;
+    fast.addIbi(ibi);
+    alert.addIbi(ibi);
+    sum += (uint32_t)(alert.bpm() * 10.0f);
+  }
+  double beatNs = nsSince(t0) / (double)edges.size();
+  sink = sink + (float)sum + fast.bpm();
+
+  // Fechamento de janela: bpm() a cada 10 s do trem
+  size_t windows = 0, errors = 0;
+  BeatTracker<64> windowed(10000000, 200000);
+  double closeNs = 0;
+  uint32_t nextClose = edges.front() + 10000000;
+  for (size_t i = 0; i < edges.size(); i++) {
+    windowed.addBeat(edges[i]);
+    if ((int32_t)(edges[i] - nextClose) < 0) continue;
+    t0 = Clock::now();
+    float bpm = windowed.bpm(nextClose);
+    closeNs += nsSince(t0);
+    errors += bpm < 45.0f || bpm > 160.0f;   // ritmo entre 50 e 150, mais o jitter
+    windows++;
+    nextClose += 10000000;
+  }
+  (void)sink;
+  printf("BENCH_BEATS bordas=%zu batimento_ns=%.1f janela_ns=%.1f janelas=%zu recusados=%zu bounces=%zu "
+         "erros=%zu\r\n",
+         edges.size(), beatNs, closeNs / (double)windows, windows, rejected, bounces, errors);
+  TEST_ASSERT_EQUAL(bounces, rejected);
+  TEST_ASSERT_EQUAL(BEATS, beats.totalBeats());
+  TEST_ASSERT_GREATER_THAN(0, windows);
+  TEST_ASSERT_EQUAL(0, errors);
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_bench_json);
+  RUN_TEST(test_bench_queue);
+  RUN_TEST(test_bench_blocks);
+  RUN_TEST(test_bench_stats);
+  RUN_TEST(test_bench_flash_log);
+  RUN_TEST(test_bench_beats);
+  return UNITY_END();
+}
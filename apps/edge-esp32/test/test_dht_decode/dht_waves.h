@@ -0,0 +1,19 @@
+#pragma once
+// Capturas do DHT22 no formato de CARDIOIA_SIM_DHT_WAVE (hal_native.h): uma
+// leitura por linha, durações em µs alternando os níveis a partir do HIGH
+// entre a liberação da linha e a resposta ('#' comenta). Salvas num arquivo,
+// servem também ao programa native.
+static const char* const DHT_WAVES = R"(
+# 36,5 °C, 55,0 %
+26 84 77 54 25 52 27 54 26 48 26 47 26 52 27 50 67 51 26 46 25 47 25 47 74 53 28 47 23 52 66 47 72 52 29 50 30 48 28 49 30 47 25 52 25 48 24 53 23 54 73 46 29 53 67 54 73 54 29 51 72 54 68 46 25 47 66 53 72 53 23 50 24 53 70 53 28 50 68 53 73 50 26 46
+# -10,1 °C, 45,3 %
+27 79 80 52 23 53 23 53 30 53 22 48 28 50 23 47 24 48 72 50 73 47 69 53 23 52 24 46 28 50 66 54 27 50 69 50 74 51 22 46 26 49 23 49 26 54 29 54 24 51 30 50 30 50 74 50 74 52 29 46 25 48 66 53 23 54 67 50 73 52 27 51 71 48 29 51 67 54 29 52 66 51 67 51
+# 23,4 °C, 99,9 %
+32 81 83 51 22 50 26 50 23 49 28 46 24 48 29 54 67 54 67 46 72 46 68 51 69 54 30 46 26 49 68 49 70 47 73 48 23 53 26 54 28 49 27 47 25 50 24 51 29 54 25 54 73 50 66 53 67 49 23 53 68 52 30 50 73 51 29 46 74 52 66 49 26 54 69 47 28 52 68 54 25 48 29 48
+# a primeira, com o HIGH do bit 0 longo (0 lido como 1): checksum
+26 84 77 54 52 52 27 54 26 48 26 47 26 52 27 50 67 51 26 46 25 47 25 47 74 53 28 47 23 52 66 47 72 52 29 50 30 48 28 49 30 47 25 52 25 48 24 53 23 54 73 46 29 53 67 54 73 54 29 51 72 54 68 46 25 47 66 53 72 53 23 50 24 53 70 53 28 50 68 53 73 50 26 46
+# a primeira, com o sensor parando depois de 20 bits
+26 84 77 54 25 52 27 54 26 48 26 47 26 52 27 50 67 51 26 46 25 47 25 47 74 53 28 47 23 52 66 47 72 52 29 50 30 48 28 49 30 47 25
+# a primeira, com um glitch de 3 µs no LOW do bit 8
+26 84 77 54 25 52 27 54 26 48 26 47 26 52 27 50 67 51 26 20 3 23 25 47 25 47 74 53 28 47 23 52 66 47 72 52 29 50 30 48 28 49 30 47 25 52 25 48 24 53 23 54 73 46 29 53 67 54 73 54 29 51 72 54 68 46 25 47 66 53 72 53 23 50 24 53 70 53 28 50 68 53 73 50 26 46
+)";
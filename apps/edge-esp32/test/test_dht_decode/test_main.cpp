@@ -0,0 +1,187 @@
+// Decodificador do DHT22 (dht_decode.h) sobre as capturas de dht_waves.h e
+// variações sintéticas: quadro bom, checksum, bordas perdidas ou a mais,
+// limites de intervalo e jitter em volta do limiar do bit.
+#include <unity.h>
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <random>
+#include <vector>
+#include "dht_decode.h"
+#include "dht_waves.h"
+
+typedef std::vector<uint32_t> Edges;
+
+// Mesmo formato de sim::loadDhtWaveforms(): uma leitura por linha
+static std::vector<Edges> loadWaves() {
+  std::vector<Edges> waves;
+  Edges wave;
+  for (const char* p = DHT_WAVES; *p;) {
+    if (*p == '#') {
+      while (*p && *p != '\n') p++;
+    } else if (*p == '\n') {
+      if (!wave.empty()) waves.push_back(wave);
+      wave.clear();
+      p++;
+    } else if (isdigit((unsigned char)*p)) {
+      char* end;
+      wave.push_back((uint32_t)strtoul(p, &end, 10));
+      p = end;
+    } else {
+      p++;
+    }
+  }
+  if (!wave.empty()) waves.push_back(wave);
+  return waves;
+}
+
+// Durações alternando HIGH/LOW a partir do HIGH: a ISR vê uma descida no fim
+// de cada HIGH (índices pares)
+static Edges fallingEdges(const Edges& wave, uint32_t startUs) {
+  Edges falls;
+  uint32_t t = startUs;
+  for (size_t i = 0; i < wave.size(); i++) {
+    t += wave[i];
+    if (i % 2 == 0) falls.push_back(t);
+  }
+  return falls;
+}
+
+// Quadro sintético: resposta e bits com intervalos entre descidas dados
+static Edges syntheticEdges(const uint8_t b[5], uint32_t responseUs, uint32_t zeroUs, uint32_t oneUs,
+                            uint32_t startUs = 1000) {
+  Edges falls = {startUs, startUs + responseUs};
+  for (size_t bit = 0; bit < 40; bit++) {
+    bool one = (b[bit / 8] >> (7 - bit % 8)) & 1;
+    falls.push_back(falls.back() + (one ? oneUs : zeroUs));
+  }
+  return falls;
+}
+
+static DhtStatus decode(const Edges& falls, float& t, float& h) {
+  return dhtDecode(falls.data(), falls.size(), t, h);
+}
+
+static const uint8_t FRAME_36_5[5] = {0x02, 0x26, 0x01, 0x6D, 0x96};   // 55,0 %, 36,5 °C
+
+void setUp() {}
+void tearDown() {}
+
+// Cada captura com o status e os valores esperados; a contagem por status
+// fecha com a tabela
+void test_recorded_waves() {
+  struct Want {
+    DhtStatus status;
+    float temp, hum;
+  };
+  const Want want[] = {
+      {DHT_OK, 36.5f, 55.0f},      {DHT_OK, -10.1f, 45.3f},     {DHT_OK, 23.4f, 99.9f},
+      {DHT_ERR_CHECKSUM, 0, 0},    {DHT_ERR_MISSED, 0, 0},      {DHT_ERR_TIMING, 0, 0},
+  };
+  std::vector<Edges> waves = loadWaves();
+  TEST_ASSERT_EQUAL(6, waves.size());
+  size_t counts[DHT_STATUS_COUNT] = {0};
+  for (size_t i = 0; i < waves.size(); i++) {
+    float t = NAN, h = NAN;
+    DhtStatus st = decode(fallingEdges(waves[i], 5000), t, h);
+    TEST_ASSERT_EQUAL_STRING(dhtStatusName(want[i].status), dhtStatusName(st));
+    counts[st]++;
+    if (st != DHT_OK) continue;
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, want[i].temp, t);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, want[i].hum, h);
+  }
+  TEST_ASSERT_EQUAL(3, counts[DHT_OK]);
+  TEST_ASSERT_EQUAL(1, counts[DHT_ERR_CHECKSUM]);
+  TEST_ASSERT_EQUAL(1, counts[DHT_ERR_MISSED]);
+  TEST_ASSERT_EQUAL(1, counts[DHT_ERR_TIMING]);
+}
+
+// Cada borda da captura boa perdida, uma de cada vez: nunca DHT_OK
+void test_each_missing_edge_is_an_error() {
+  Edges good = fallingEdges(loadWaves()[0], 5000);
+  size_t counts[DHT_STATUS_COUNT] = {0};
+  for (size_t k = 0; k < good.size(); k++) {
+    Edges falls = good;
+    falls.erase(falls.begin() + k);
+    float t, h;
+    counts[decode(falls, t, h)]++;
+  }
+  TEST_ASSERT_EQUAL(0, counts[DHT_OK]);
+  TEST_ASSERT_EQUAL(good.size(), counts[DHT_ERR_MISSED] + counts[DHT_ERR_TIMING]);
+  float t, h;
+  TEST_ASSERT_EQUAL(DHT_ERR_NO_RESPONSE, dhtDecode(nullptr, 0, t, h));
+}
+
+// Limites de intervalo: resposta e bit dentro da faixa decodificam, um µs
+// fora é erro; o limiar do bit é DHT_BIT_ONE_US (igual = 0, acima = 1)
+void test_interval_limits_and_bit_threshold() {
+  float t, h;
+  TEST_ASSERT_EQUAL(DHT_OK, decode(syntheticEdges(FRAME_36_5, 160, DHT_BIT_ONE_US, DHT_BIT_ONE_US + 1), t, h));
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 36.5f, t);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 55.0f, h);
+  TEST_ASSERT_EQUAL(DHT_OK, decode(syntheticEdges(FRAME_36_5, DHT_RESPONSE_MIN_US, DHT_BIT_MIN_US, DHT_BIT_MAX_US), t, h));
+  TEST_ASSERT_EQUAL(DHT_OK, decode(syntheticEdges(FRAME_36_5, DHT_RESPONSE_MAX_US, 76, 120), t, h));
+  TEST_ASSERT_EQUAL(DHT_ERR_TIMING, decode(syntheticEdges(FRAME_36_5, DHT_RESPONSE_MIN_US - 1, 76, 120), t, h));
+  TEST_ASSERT_EQUAL(DHT_ERR_MISSED, decode(syntheticEdges(FRAME_36_5, DHT_RESPONSE_MAX_US + 1, 76, 120), t, h));
+  TEST_ASSERT_EQUAL(DHT_ERR_TIMING, decode(syntheticEdges(FRAME_36_5, 160, DHT_BIT_MIN_US - 1, 120), t, h));
+  TEST_ASSERT_EQUAL(DHT_ERR_MISSED, decode(syntheticEdges(FRAME_36_5, 160, 76, DHT_BIT_MAX_US + 1), t, h));
+  // Os zeros um µs acima do limiar viram uns: o checksum pega
+  TEST_ASSERT_EQUAL(DHT_ERR_CHECKSUM, decode(syntheticEdges(FRAME_36_5, 160, DHT_BIT_ONE_US + 1, 120), t, h));
+  // Checksum certo, mas umidade acima de 100 %
+  const uint8_t wet[5] = {0x03, 0xE9, 0x01, 0x6D, (uint8_t)(0x03 + 0xE9 + 0x01 + 0x6D)};
+  TEST_ASSERT_EQUAL(DHT_ERR_RANGE, decode(syntheticEdges(wet, 160, 76, 120), t, h));
+}
+
+// Descidas perto da volta do micros()
+void test_micros_wrap() {
+  float t, h;
+  Edges falls = fallingEdges(loadWaves()[1], UINT32_MAX - 2000);
+  TEST_ASSERT_TRUE(falls.back() < falls.front());
+  TEST_ASSERT_EQUAL(DHT_OK, decode(falls, t, h));
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, -10.1f, t);
+}
+
+// Latência da ISR em cada descida: com ±5 µs toda leitura sai certa; com
+// ±15 µs os bits perto do limiar trocam e quase sempre viram erro. O
+// checksum é uma soma de 8 bits: bits trocados aos pares às vezes passam,
+// com valor errado ("errado" no log)
+void test_isr_jitter() {
+  std::mt19937 rng(19);
+  Edges good = fallingEdges(loadWaves()[0], 5000);
+  for (uint32_t jitter : {5u, 15u}) {
+    size_t counts[DHT_STATUS_COUNT] = {0};
+    size_t wrong = 0;
+    for (int run = 0; run < 2000; run++) {
+      Edges falls = good;
+      for (uint32_t& f : falls) f = f - jitter + rng() % (2 * jitter + 1);
+      float t = NAN, h = NAN;
+      DhtStatus st = decode(falls, t, h);
+      counts[st]++;
+      if (st == DHT_OK && (fabsf(t - 36.5f) > 0.01f || fabsf(h - 55.0f) > 0.01f)) wrong++;
+    }
+    printf("DHT_JITTER us=%lu ok=%lu errado=%lu checksum=%lu tempo=%lu borda_perdida=%lu faixa=%lu\n",
+           (unsigned long)jitter, (unsigned long)counts[DHT_OK], (unsigned long)wrong,
+           (unsigned long)counts[DHT_ERR_CHECKSUM],
+           (unsigned long)counts[DHT_ERR_TIMING], (unsigned long)counts[DHT_ERR_MISSED],
+           (unsigned long)counts[DHT_ERR_RANGE]);
+    if (jitter == 5) {
+      TEST_ASSERT_EQUAL(2000, counts[DHT_OK]);
+      TEST_ASSERT_EQUAL(0, wrong);
+    } else {
+      TEST_ASSERT_GREATER_THAN(0, counts[DHT_ERR_CHECKSUM]);
+      TEST_ASSERT_LESS_THAN(2000, counts[DHT_OK]);
+      TEST_ASSERT_LESS_THAN(counts[DHT_ERR_CHECKSUM] / 10, wrong);
+    }
+  }
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_recorded_waves);
+  RUN_TEST(test_each_missing_edge_is_an_error);
+  RUN_TEST(test_interval_limits_and_bit_threshold);
+  RUN_TEST(test_micros_wrap);
+  RUN_TEST(test_isr_jitter);
+  return UNITY_END();
+}
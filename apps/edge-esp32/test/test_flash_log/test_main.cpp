@@ -0,0 +1,180 @@
+// FlashLog (flash_log.h): peek/pop só leem, o commit() é que grava a
+// posição e apaga segmentos. Um "reboot" (FlashLog novo no mesmo storage)
+// antes do commit reenvia o que foi lido; depois dele, retoma na posição
+// confirmada menos o que ficou sem ack (keep).
+#include <unity.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+#include "flash_log.h"
+#include "sample.h"
+
+// Storage em memória: cada teste começa com a flash vazia
+class MemStorage : public LogStorage {
+public:
+  bool begin() override { return true; }
+  bool append(const char* name, const void* data, size_t len) override {
+    std::vector<uint8_t>& f = files[name];
+    f.insert(f.end(), (const uint8_t*)data, (const uint8_t*)data + len);
+    bytesWritten += len;
+    return true;
+  }
+  size_t read(const char* name, size_t off, void* data, size_t len) override {
+    auto it = files.find(name);
+    if (it == files.end() || off >= it->second.size()) return 0;
+    size_t n = std::min(len, it->second.size() - off);
+    memcpy(data, it->second.data() + off, n);
+    bytesRead += n;
+    return n;
+  }
+  long size(const char* name) override {
+    auto it = files.find(name);
+    return it == files.end() ? -1 : (long)it->second.size();
+  }
+  bool remove(const char* name) override { return files.erase(name) > 0; }
+  bool replace(const char* name, const void* data, size_t len) override {
+    files[name].assign((const uint8_t*)data, (const uint8_t*)data + len);
+    bytesWritten += len;
+    return true;
+  }
+
+  size_t segments() const {
+    size_t n = 0;
+    for (const auto& f : files) n += f.first.find(".seg") != std::string::npos;
+    return n;
+  }
+  std::map<std::string, std::vector<uint8_t>> files;
+};
+
+static const size_t N = 600;   // pouco mais de 2 segmentos
+
+static Sample windowAt(uint32_t i) { return makeSample(10000 + i * 10000, 36.5f, 55.0f, 60 + (int)(i % 40), false); }
+
+static void fill(FlashLog& log) {
+  std::vector<Sample> in;
+  for (uint32_t i = 0; i < N; i++) in.push_back(windowAt(i));
+  TEST_ASSERT_TRUE(log.append(in.data(), in.size()));
+}
+
+static void readN(FlashLog& log, uint32_t from, size_t n) {
+  Sample s;
+  for (uint32_t i = from; i < from + n; i++) {
+    TEST_ASSERT_TRUE(log.peek(s));
+    TEST_ASSERT_EQUAL_UINT32(windowAt(i).ts, s.ts);
+    log.pop();
+  }
+}
+
+static void assertNextIs(FlashLog& log, uint32_t i) {
+  Sample s;
+  TEST_ASSERT_TRUE(log.peek(s));
+  TEST_ASSERT_EQUAL_UINT32(windowAt(i).ts, s.ts);
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_read_without_commit_keeps_everything() {
+  MemStorage st;
+  FlashLog log(st);
+  TEST_ASSERT_TRUE(log.begin());
+  fill(log);
+  size_t segs = st.segments();
+  readN(log, 0, N);
+  TEST_ASSERT_EQUAL(0, log.size());
+  TEST_ASSERT_EQUAL(segs, st.segments());   // nada apagado
+  FlashLog reboot(st);
+  TEST_ASSERT_TRUE(reboot.begin());
+  TEST_ASSERT_EQUAL(N, reboot.size());
+  assertNextIs(reboot, 0);
+}
+
+void test_commit_persists_and_drops_segments() {
+  MemStorage st;
+  FlashLog log(st);
+  TEST_ASSERT_TRUE(log.begin());
+  fill(log);
+  size_t segs = st.segments();
+  readN(log, 0, 300);
+  log.commit();
+  TEST_ASSERT_EQUAL(segs - 1, st.segments());   // 300 > FLASH_LOG_SEG_RECORDS
+  FlashLog reboot(st);
+  TEST_ASSERT_TRUE(reboot.begin());
+  TEST_ASSERT_EQUAL(N - 300, reboot.size());
+  assertNextIs(reboot, 300);
+}
+
+// Registros lidos mas ainda na janela de entrega ficam na flash
+void test_commit_keeps_unacked_tail() {
+  MemStorage st;
+  FlashLog log(st);
+  TEST_ASSERT_TRUE(log.begin());
+  fill(log);
+  readN(log, 0, 300);
+  log.commit(60);
+  assertNextIs(log, 300);   // o cursor de leitura não volta
+  FlashLog reboot(st);
+  TEST_ASSERT_TRUE(reboot.begin());
+  TEST_ASSERT_EQUAL(N - 240, reboot.size());
+  assertNextIs(reboot, 240);
+}
+
+// keep maior que o lido desde o último commit: a posição não recua
+void test_commit_never_goes_back() {
+  MemStorage st;
+  FlashLog log(st);
+  TEST_ASSERT_TRUE(log.begin());
+  fill(log);
+  readN(log, 0, 100);
+  log.commit();
+  readN(log, 100, 10);
+  log.commit(50);
+  FlashLog reboot(st);
+  TEST_ASSERT_TRUE(reboot.begin());
+  assertNextIs(reboot, 100);
+}
+
+// Tudo confirmado: o log fica vazio e volta a aceitar amostras
+void test_drained_log_is_reusable() {
+  MemStorage st;
+  FlashLog log(st);
+  TEST_ASSERT_TRUE(log.begin());
+  fill(log);
+  readN(log, 0, N);
+  log.commit();
+  Sample s;
+  TEST_ASSERT_FALSE(log.peek(s));
+  Sample more = windowAt(N);
+  TEST_ASSERT_TRUE(log.append(&more, 1));
+  FlashLog reboot(st);
+  TEST_ASSERT_TRUE(reboot.begin());
+  TEST_ASSERT_EQUAL(1, reboot.size());
+  assertNextIs(reboot, N);
+}
+
+void test_corrupted_record_is_skipped() {
+  MemStorage st;
+  FlashLog log(st);
+  TEST_ASSERT_TRUE(log.begin());
+  fill(log);
+  std::vector<uint8_t>& seg = st.files.begin()->second;   // o mais antigo
+  seg[5 * FlashLog::RECORD_SIZE + 2] ^= 0xFF;
+  FlashLog reboot(st);
+  TEST_ASSERT_TRUE(reboot.begin());
+  readN(reboot, 0, 5);
+  assertNextIs(reboot, 6);
+  TEST_ASSERT_EQUAL(1, reboot.corrupted());
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_read_without_commit_keeps_everything);
+  RUN_TEST(test_commit_persists_and_drops_segments);
+  RUN_TEST(test_commit_keeps_unacked_tail);
+  RUN_TEST(test_commit_never_goes_back);
+  RUN_TEST(test_drained_log_is_reusable);
+  RUN_TEST(test_corrupted_record_is_skipped);
+  return UNITY_END();
+}
@@ -0,0 +1,198 @@
+// Estado retido entre resets (retained.h) e a validação de estrutura que o
+// restore usa depois do CRC (SampleBlockLog::valid, sample_block.h): um
+// cabeçalho corrompido ou gravado pela metade nunca volta como RETAIN_OK, e
+// um backlog que passa no valid() esvazia e aceita amostras novas sem erro.
+#include <unity.h>
+#include <string.h>
+#include <vector>
+#include "retained.h"
+#include "sample.h"
+#include "sample_block.h"
+
+struct Payload {
+  uint32_t words[16];
+  explicit Payload(uint32_t seed) {
+    for (size_t i = 0; i < 16; i++) words[i] = seed * 2654435761u + (uint32_t)i * 40503u + 1;
+  }
+};
+
+typedef Retained<Payload, 3> Store;
+typedef Retained<Payload, 4> StoreNext;   // firmware com outro layout
+typedef Retained<Payload, 3, 16> Segmented;   // 4 segmentos de 4 palavras
+
+// Imagem crua da memória HAL_NOINIT
+template <typename T>
+static T* image(std::vector<uint8_t>& bytes) {
+  bytes.assign(sizeof(T), 0);
+  return reinterpret_cast<T*>(bytes.data());
+}
+
+static std::vector<uint8_t> sealedImage(uint32_t seed) {
+  std::vector<uint8_t> bytes;
+  image<Store>(bytes)->reset(seed);
+  return bytes;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_power_on_is_empty() {
+  std::vector<uint8_t> bytes;
+  TEST_ASSERT_EQUAL(RETAIN_EMPTY, image<Store>(bytes)->restore());
+}
+
+void test_sealed_state_round_trips() {
+  std::vector<uint8_t> bytes = sealedImage(7);
+  Store* s = reinterpret_cast<Store*>(bytes.data());
+  TEST_ASSERT_EQUAL(RETAIN_OK, s->restore());
+  TEST_ASSERT_EQUAL_UINT32(Payload(7).words[15], s->get().words[15]);
+  s->get().words[3]++;
+  TEST_ASSERT_EQUAL(RETAIN_BAD_CRC, s->restore());   // mudou sem seal()
+  s->seal();
+  TEST_ASSERT_EQUAL(RETAIN_OK, s->restore());
+}
+
+// Qualquer bit trocado em qualquer byte: nunca RETAIN_OK
+void test_any_flipped_bit_is_rejected() {
+  const std::vector<uint8_t> sealed = sealedImage(11);
+  for (size_t off = 0; off < sealed.size(); off++) {
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      std::vector<uint8_t> bytes = sealed;
+      bytes[off] ^= (uint8_t)(1u << bit);
+      RetainStatus st = reinterpret_cast<Store*>(bytes.data())->restore();
+      TEST_ASSERT_TRUE(st != RETAIN_OK);
+    }
+  }
+}
+
+// Gravação interrompida: só um prefixo da imagem nova chegou, o resto é a
+// imagem anterior (ou zeros, num power-on)
+void test_partial_write_is_rejected() {
+  const std::vector<uint8_t> oldImage = sealedImage(1), newImage = sealedImage(2);
+  const std::vector<uint8_t> zeros(oldImage.size(), 0);
+  for (const std::vector<uint8_t>* under : {&oldImage, &zeros}) {
+    for (size_t n = 0; n < newImage.size(); n++) {
+      std::vector<uint8_t> bytes = *under;
+      memcpy(bytes.data(), newImage.data(), n);
+      // OK só com uma imagem inteira (nada gravado, ou o resto já era igual)
+      bool whole = bytes == oldImage || bytes == newImage;
+      TEST_ASSERT_EQUAL(whole, reinterpret_cast<Store*>(bytes.data())->restore() == RETAIN_OK);
+    }
+  }
+}
+
+void test_other_layout_is_rejected() {
+  std::vector<uint8_t> bytes = sealedImage(5);
+  TEST_ASSERT_EQUAL(RETAIN_BAD_LAYOUT, reinterpret_cast<StoreNext*>(bytes.data())->restore());
+}
+
+void test_other_segment_size_is_rejected() {
+  std::vector<uint8_t> bytes;
+  image<Segmented>(bytes)->reset(5);
+  TEST_ASSERT_EQUAL(RETAIN_OK, reinterpret_cast<Segmented*>(bytes.data())->restore());
+  TEST_ASSERT_EQUAL(RETAIN_BAD_LAYOUT, reinterpret_cast<Store*>(bytes.data())->restore());
+}
+
+// seal(p, n) refaz só os segmentos de [p, p + n): outro segmento mudado
+// continua com o CRC velho
+void test_partial_seal_covers_only_its_segments() {
+  std::vector<uint8_t> bytes;
+  Segmented* s = image<Segmented>(bytes);
+  s->reset(9);
+  Payload& p = s->get();
+  p.words[1]++;    // segmento 0
+  p.words[9]++;    // segmento 2
+  s->seal(&p.words[1], sizeof(p.words[1]));
+  TEST_ASSERT_EQUAL(RETAIN_BAD_CRC, s->restore());
+  s->seal(&p.words[9], sizeof(p.words[9]));
+  TEST_ASSERT_EQUAL(RETAIN_OK, s->restore());
+  p.words[3]++;    // fim do segmento 0
+  p.words[4]++;    // início do segmento 1
+  s->seal(&p.words[3], 2 * sizeof(p.words[3]));
+  TEST_ASSERT_EQUAL(RETAIN_OK, s->restore());
+  p.words[15]++;
+  s->seal(&p.words[15], 64);   // passa do fim: só até o fim do T
+  TEST_ASSERT_EQUAL(RETAIN_OK, s->restore());
+}
+
+// O cabeçalho e a tabela não guardam lixo do boot anterior: o mesmo T selado
+// sobre RAM qualquer dá a mesma imagem
+void test_sealed_image_is_deterministic() {
+  std::vector<uint8_t> clean, dirty;
+  image<Segmented>(clean)->reset(3);
+  Segmented* s = image<Segmented>(dirty);
+  memset(dirty.data(), 0xA5, dirty.size());
+  s->reset(3);
+  TEST_ASSERT_TRUE(clean == dirty);
+}
+
+typedef SampleBlockLog<4, 64> Blocks;
+static const uint32_t WINDOW_MS = 10000;
+
+static Sample windowAt(uint32_t i) {
+  return makeSample(10000 + i * WINDOW_MS + (i % 5 == 0), 36.0f + (i % 9) * 0.1f, 50.0f + (i % 3),
+                    70 + (int)(i % 11), i % 2);
+}
+
+// Cada bit de um backlog em blocos (com o cursor no meio do bloco mais
+// antigo, com e sem amostra em cache): se o valid() aceita, o backlog
+// esvazia sem erro de decodificação e uma amostra nova volta igual
+void test_block_log_valid_guards_every_bit() {
+  static Blocks base(WINDOW_MS);
+  for (uint32_t i = 0; i < 25; i++) base.push(windowAt(i));
+  for (int i = 0; i < 5; i++) base.pop();
+  Sample s;
+  for (bool cached : {false, true}) {
+    if (cached) base.peek(s);
+    TEST_ASSERT_TRUE(base.valid());
+    size_t rejected = 0;
+    for (size_t off = 0; off < sizeof(Blocks); off++) {
+      for (uint8_t bit = 0; bit < 8; bit++) {
+        static Blocks log(WINDOW_MS);
+        memcpy((void*)&log, (const void*)&base, sizeof(Blocks));
+        reinterpret_cast<uint8_t*>(&log)[off] ^= (uint8_t)(1u << bit);
+        if (!log.valid()) { rejected++; continue; }
+        if (log.full()) continue;
+        size_t want = log.size() + 1;
+        Sample fresh = windowAt(100);
+        TEST_ASSERT_TRUE(log.push(fresh));
+        size_t got = 0;
+        while (log.size()) {
+          TEST_ASSERT_TRUE(log.peek(s));
+          log.pop();
+          got++;
+        }
+        TEST_ASSERT_EQUAL(want, got);
+        TEST_ASSERT_EQUAL_MEMORY(&fresh, &s, sizeof(s));
+      }
+    }
+    TEST_ASSERT_GREATER_THAN(0, rejected);
+  }
+}
+
+void test_block_log_drained_and_reused_stays_valid() {
+  static Blocks log(WINDOW_MS);
+  Sample s;
+  for (uint32_t i = 0; i < 2000; i++) {
+    if (log.full()) log.evictBlock([](const Sample&) {});
+    log.push(windowAt(i));
+    if (i % 3 == 0) log.pop();
+    if (i % 7 == 0) log.peek(s);
+    TEST_ASSERT_TRUE(log.valid());
+  }
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_power_on_is_empty);
+  RUN_TEST(test_sealed_state_round_trips);
+  RUN_TEST(test_any_flipped_bit_is_rejected);
+  RUN_TEST(test_partial_write_is_rejected);
+  RUN_TEST(test_other_layout_is_rejected);
+  RUN_TEST(test_other_segment_size_is_rejected);
+  RUN_TEST(test_partial_seal_covers_only_its_segments);
+  RUN_TEST(test_sealed_image_is_deterministic);
+  RUN_TEST(test_block_log_valid_guards_every_bit);
+  RUN_TEST(test_block_log_drained_and_reused_stays_valid);
+  return UNITY_END();
+}
@@ -0,0 +1,111 @@
+// Agregados e compactador (sample_agg.h): numa queda longa o histórico
+// perde resolução mas cobre o período inteiro, sem buracos nem janelas
+// perdidas, e as médias saem ponderadas.
+#include <unity.h>
+#include <vector>
+#include "sample.h"
+#include "sample_agg.h"
+
+static const uint32_t WINDOW_MS = 10000;
+typedef SampleCompactor<4, 32> Compactor;   // RAM_COMPACT_LEVELS / _PER_LEVEL
+
+void setUp() {}
+void tearDown() {}
+
+static Sample windowAt(uint32_t i) {
+  return makeSample(10000 + i * WINDOW_MS, 36.0f + (i % 20) * 0.1f, 50.0f + (i % 7), 60 + (int)(i % 50), false);
+}
+
+// Esvazia do mais antigo ao mais novo: registros em ordem, sem sobreposição
+// nem buraco entre vizinhos, e a soma das contagens bate
+static void drainContiguous(Compactor& c, uint32_t firstTs, uint32_t lastTs, uint32_t windows) {
+  SampleRecord r;
+  uint32_t expectTs = firstTs, total = 0;
+  size_t records = c.size();
+  while (c.peek(r)) {
+    TEST_ASSERT_TRUE(recordIsAgg(r));
+    TEST_ASSERT_EQUAL_UINT32(expectTs, r.s.ts);
+    TEST_ASSERT_EQUAL_UINT32(r.s.ts + (r.agg.count - 1) * WINDOW_MS, r.agg.tsEnd);
+    expectTs = r.agg.tsEnd + WINDOW_MS;
+    total += r.agg.count;
+    c.pop();
+    records--;
+  }
+  TEST_ASSERT_EQUAL(0, records);
+  TEST_ASSERT_EQUAL_UINT32(lastTs + WINDOW_MS, expectTs);
+  TEST_ASSERT_EQUAL_UINT32(windows, total);
+  TEST_ASSERT_EQUAL_UINT32(0, c.windows());
+}
+
+// 30 dias offline em janelas de 10 s (259200 janelas) em 128 registros
+void test_long_outage_covers_whole_span() {
+  static Compactor c(6);
+  const uint32_t N = 30u * 24 * 360;
+  for (uint32_t i = 0; i < N; i++) {
+    c.add(windowAt(i));
+    if (i % 4099 == 0) TEST_ASSERT_TRUE(c.valid());
+  }
+  TEST_ASSERT_TRUE(c.valid());
+  TEST_ASSERT_LESS_OR_EQUAL(Compactor::capacity(), c.size());
+  TEST_ASSERT_EQUAL_UINT32(N, c.windows());
+  TEST_ASSERT_EQUAL_UINT32(0, c.dropped());
+  drainContiguous(c, windowAt(0).ts, windowAt(N - 1).ts, N);
+}
+
+// Resolução mais fina no recente: o registro mais novo cobre no máximo
+// base janelas
+void test_recent_windows_keep_resolution() {
+  static Compactor c(6);
+  for (uint32_t i = 0; i < 10000; i++) c.add(windowAt(i));
+  SampleRecord r, newest = {};
+  while (c.peek(r)) {
+    newest = r;
+    c.pop();
+  }
+  TEST_ASSERT_LESS_OR_EQUAL(6, newest.agg.count);
+  TEST_ASSERT_EQUAL_UINT32(windowAt(9999).ts, newest.agg.tsEnd);
+}
+
+// Além de 32 * 65535 janelas o mais antigo é descartado, e o que fica
+// continua contíguo até a janela mais nova (o ts dá a volta do millis()
+// no caminho)
+void test_beyond_capacity_drops_oldest_only() {
+  static Compactor c(6);
+  const uint32_t N = 32u * 65535 + 300000;
+  for (uint32_t i = 0; i < N; i++) c.add(windowAt(i));
+  TEST_ASSERT_TRUE(c.valid());
+  TEST_ASSERT_GREATER_THAN(0, c.dropped());
+  TEST_ASSERT_EQUAL_UINT32(N, c.windows() + c.dropped());
+  drainContiguous(c, windowAt(c.dropped()).ts, windowAt(N - 1).ts, N - c.dropped());
+}
+
+// Médias ponderadas pelas janelas com leitura; extremos; NaN não entra
+void test_merge_weights_and_extremes() {
+  SampleRecord a = aggFromSample(makeSample(1000, 36.0f, 40.0f, 60, false));
+  SampleRecord b = aggFromSample(makeSample(2000, 39.0f, 60.0f, 130, false));
+  SampleRecord nan = aggFromSample(makeSample(3000, NAN, NAN, 90, false));
+  TEST_ASSERT_TRUE(aggMerge(a, b));
+  TEST_ASSERT_TRUE(aggMerge(a, b));   // b pesa 2
+  TEST_ASSERT_TRUE(aggMerge(a, nan));
+  TEST_ASSERT_EQUAL(4, a.agg.count);
+  TEST_ASSERT_EQUAL(3, a.agg.tempN);
+  TEST_ASSERT_EQUAL_INT16(3800, a.s.temp);
+  TEST_ASSERT_EQUAL_UINT16(5333, a.s.hum);
+  TEST_ASSERT_EQUAL_UINT16(103, a.s.bpm);   // (60 + 130 * 2 + 90) / 4 = 102,5
+  TEST_ASSERT_EQUAL_INT16(3600, a.agg.tempMin);
+  TEST_ASSERT_EQUAL_INT16(3900, a.agg.tempMax);
+  TEST_ASSERT_EQUAL_UINT16(60, a.agg.bpmMin);
+  TEST_ASSERT_EQUAL_UINT16(130, a.agg.bpmMax);
+  TEST_ASSERT_EQUAL_UINT32(1000, a.s.ts);
+  TEST_ASSERT_EQUAL_UINT32(3000, a.agg.tsEnd);
+  TEST_ASSERT_FALSE(a.s.flags & SAMPLE_F_TEMP_NAN);
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_long_outage_covers_whole_span);
+  RUN_TEST(test_recent_windows_keep_resolution);
+  RUN_TEST(test_beyond_capacity_drops_oldest_only);
+  RUN_TEST(test_merge_weights_and_extremes);
+  return UNITY_END();
+}
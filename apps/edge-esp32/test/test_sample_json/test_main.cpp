@@ -0,0 +1,150 @@
+// JSON sem alocação (sample_json.h): saída byte a byte igual à do formato
+// anterior, montado com String += e String(float, 2) a partir dos floats da
+// janela, em toda a faixa do DHT22 (resolução 0,1) e com leituras NaN.
+#include <unity.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <random>
+#include "sample.h"
+#include "sample_agg.h"
+#include "sample_json.h"
+#include "sample_stats.h"
+
+// O makeSampleJson() antigo: String(float, 2) formata como "%.2f"
+static void legacyJson(char* out, size_t cap, uint32_t ts, float temp, float hum, int bpm, bool connected) {
+  char t[24], h[24];
+  if (isnan(temp)) strcpy(t, "nan");
+  else snprintf(t, sizeof(t), "%.2f", (double)temp);
+  if (isnan(hum)) strcpy(h, "nan");
+  else snprintf(h, sizeof(h), "%.2f", (double)hum);
+  snprintf(out, cap, "{\"ts\":%lu,\"temp\":%s,\"hum\":%s,\"bpm\":%d,\"connected\":%s}", (unsigned long)ts, t, h,
+           bpm, connected ? "true" : "false");
+}
+
+static void assertSameAsLegacy(uint32_t ts, float temp, float hum, int bpm, bool connected) {
+  char want[128], got[SAMPLE_JSON_MAX];
+  legacyJson(want, sizeof(want), ts, temp, hum, bpm, connected);
+  size_t n = formatSampleJson(got, sizeof(got), makeSample(ts, temp, hum, bpm, connected));
+  TEST_ASSERT_EQUAL_STRING(want, got);
+  TEST_ASSERT_EQUAL(strlen(want), n);
+}
+
+void setUp() {}
+void tearDown() {}
+
+// Toda a faixa do DHT22: -40,0..80,0 °C e 0,0..100,0 %
+void test_dht_range_matches_legacy() {
+  for (int t = -400; t <= 800; t++) assertSameAsLegacy(123456, t / 10.0f, 52.1f, 72, true);
+  for (int h = 0; h <= 1000; h++) assertSameAsLegacy(123456, 26.5f, h / 10.0f, 72, false);
+}
+
+void test_edges_match_legacy() {
+  assertSameAsLegacy(0, 0.0f, 0.0f, 0, false);
+  assertSameAsLegacy(UINT32_MAX, -0.5f, 0.05f, 65535, true);
+  assertSameAsLegacy(10000, -9.99f, 99.99f, 120, true);
+  assertSameAsLegacy(10000, 38.01f, 100.0f, 121, true);
+  assertSameAsLegacy(10000, NAN, 55.0f, 60, true);
+  assertSameAsLegacy(10000, 36.5f, NAN, 60, true);
+  assertSameAsLegacy(10000, NAN, NAN, 0, false);
+}
+
+// Empates exatos em binário (x,125; x,375; ...): o "%.2f" arredonda para o
+// par, e o ponto fixo também
+void test_ties_match_legacy() {
+  for (int k = -320; k <= 640; k++) assertSameAsLegacy(10000, k / 8.0f, k < 0 ? -k / 8.0f : k / 8.0f, 72, true);
+  assertSameAsLegacy(10000, 0.125f, 0.375f, 72, true);   // "0.12" e "0.38"
+}
+
+// Floats quaisquer na faixa, fora da resolução do DHT22
+void test_random_floats_match_legacy() {
+  std::mt19937 rng(2);
+  std::uniform_real_distribution<float> temp(-40.0f, 80.0f), hum(0.0f, 100.0f);
+  for (int i = 0; i < 200000; i++) {
+    float t = temp(rng);
+    if (t < 0.0f && t > -0.005f) continue;   // zero negativo, ver abaixo
+    assertSameAsLegacy(10000, t, hum(rng), 72, true);
+  }
+}
+
+// Única diferença: o ponto fixo não tem zero negativo. O DHT22 manda -0,0
+// com o bit de sinal e magnitude 0; o antigo escrevia "-0.00", agora sai
+// "0.00" (o mesmo número para quem lê o JSON)
+void test_negative_zero_is_plain_zero() {
+  char want[128], got[SAMPLE_JSON_MAX];
+  for (float t : {-0.0f, -0.004f}) {
+    legacyJson(want, sizeof(want), 10000, t, 55.0f, 72, true);
+    TEST_ASSERT_EQUAL_STRING("{\"ts\":10000,\"temp\":-0.00,\"hum\":55.00,\"bpm\":72,\"connected\":true}", want);
+    formatSampleJson(got, sizeof(got), makeSample(10000, t, 55.0f, 72, true));
+    TEST_ASSERT_EQUAL_STRING("{\"ts\":10000,\"temp\":0.00,\"hum\":55.00,\"bpm\":72,\"connected\":true}", got);
+  }
+}
+
+void test_sample_golden() {
+  char out[SAMPLE_JSON_MAX];
+  formatSampleJson(out, sizeof(out), makeSample(123456, 26.5f, 52.1f, 72, true));
+  TEST_ASSERT_EQUAL_STRING("{\"ts\":123456,\"temp\":26.50,\"hum\":52.10,\"bpm\":72,\"connected\":true}", out);
+}
+
+// Pior caso cabe no buffer e buffer pequeno não escreve nada
+void test_buffer_bounds() {
+  Sample s = makeSample(UINT32_MAX, -327.68f, 655.35f, 65535, false);
+  char out[SAMPLE_JSON_MAX];
+  size_t n = formatSampleJson(out, sizeof(out), s);
+  TEST_ASSERT_LESS_THAN(SAMPLE_JSON_MAX, n);
+  TEST_ASSERT_EQUAL_STRING("{\"ts\":4294967295,\"temp\":-327.68,\"hum\":655.35,\"bpm\":65535,\"connected\":false}", out);
+  TEST_ASSERT_EQUAL(0, formatSampleJson(out, SAMPLE_JSON_MAX - 1, s));
+  char rec[RECORD_JSON_MAX];
+  TEST_ASSERT_EQUAL(0, formatRecordJson(rec, RECORD_JSON_MAX - 1, sampleRecord(s)));
+}
+
+// Janela simples como registro: mesma saída do formato da amostra
+void test_plain_record_is_sample_json() {
+  Sample s = makeSample(20000, 37.25f, 48.0f, 80, true);
+  char a[SAMPLE_JSON_MAX], b[RECORD_JSON_MAX];
+  formatSampleJson(a, sizeof(a), s);
+  formatRecordJson(b, sizeof(b), sampleRecord(s));
+  TEST_ASSERT_EQUAL_STRING(a, b);
+}
+
+void test_aggregate_golden() {
+  SampleRecord r = aggFromSample(makeSample(10000, 36.5f, 50.0f, 70, false));
+  aggMerge(r, aggFromSample(makeSample(20000, 38.5f, 60.0f, 130, false)));
+  char out[RECORD_JSON_MAX];
+  formatRecordJson(out, sizeof(out), r);
+  TEST_ASSERT_EQUAL_STRING("{\"ts\":10000,\"ts_end\":20000,\"n\":2,\"temp\":37.50,\"temp_min\":36.50,"
+                           "\"temp_max\":38.50,\"hum\":55.00,\"hum_min\":50.00,\"hum_max\":60.00,"
+                           "\"bpm\":100,\"bpm_min\":70,\"bpm_max\":130}",
+                           out);
+}
+
+void test_stats_golden() {
+  WindowStats w;
+  w.addDht(36.4f, 50.0f);
+  w.addDht(36.6f, 52.0f);
+  w.ibi.add(800000);
+  w.ibi.add(820000);
+  w.ibi.add(780000);
+  char out[RECORD_JSON_MAX];
+  formatRecordJson(out, sizeof(out), sampleRecord(makeSample(30000, 36.6f, 52.0f, 75, true), w.close()));
+  TEST_ASSERT_EQUAL_STRING("{\"ts\":30000,\"temp\":36.60,\"hum\":52.00,\"bpm\":75,\"connected\":true,\"dht_n\":2,"
+                           "\"temp_mean\":36.50,\"temp_sd\":0.14,\"temp_min\":36.40,\"temp_max\":36.60,"
+                           "\"hum_mean\":51.00,\"hum_sd\":1.41,\"hum_min\":50.00,\"hum_max\":52.00,"
+                           "\"ibi_n\":3,\"sdnn\":20.0,\"rmssd\":31.6}",
+                           out);
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_dht_range_matches_legacy);
+  RUN_TEST(test_edges_match_legacy);
+  RUN_TEST(test_ties_match_legacy);
+  RUN_TEST(test_random_floats_match_legacy);
+  RUN_TEST(test_negative_zero_is_plain_zero);
+  RUN_TEST(test_sample_golden);
+  RUN_TEST(test_buffer_bounds);
+  RUN_TEST(test_plain_record_is_sample_json);
+  RUN_TEST(test_aggregate_golden);
+  RUN_TEST(test_stats_golden);
+  return UNITY_END();
+}
@@ -0,0 +1,143 @@
+// SampleQueue (sample_queue.h): descarte e prioridade com tráfego misto,
+// conferidos contra um modelo com duas std::deque.
+#include <unity.h>
+#include <deque>
+#include <random>
+#include "sample.h"
+#include "sample_queue.h"
+
+static Sample normal(uint32_t ts) { return makeSample(ts, 36.5f, 55.0f, 75, false); }
+static Sample fever(uint32_t ts) { return makeSample(ts, 39.0f, 55.0f, 75, false); }
+static Sample tachy(uint32_t ts) { return makeSample(ts, 36.5f, 55.0f, 130, false); }
+
+void setUp() {}
+void tearDown() {}
+
+void test_alerts_leave_first_in_arrival_order() {
+  SampleQueue<8> q;
+  q.push(normal(1));
+  q.push(fever(2));
+  q.push(normal(3));
+  q.push(tachy(4));
+  const uint32_t order[] = {2, 4, 1, 3};
+  Sample s;
+  for (uint32_t ts : order) {
+    TEST_ASSERT_TRUE(q.peek(s));
+    TEST_ASSERT_EQUAL_UINT32(ts, s.ts);
+    q.pop();
+  }
+  TEST_ASSERT_TRUE(q.empty());
+  TEST_ASSERT_FALSE(q.peek(s));
+}
+
+void test_full_drops_oldest_normal_first() {
+  SampleQueue<4> q;
+  q.push(normal(1));
+  q.push(fever(2));
+  q.push(normal(3));
+  q.push(normal(4));
+  TEST_ASSERT_FALSE(q.push(fever(5)));   // sai a normal 1
+  TEST_ASSERT_FALSE(q.push(normal(6)));  // sai a normal 3
+  TEST_ASSERT_EQUAL(2, q.droppedNormal());
+  TEST_ASSERT_EQUAL(0, q.droppedAlert());
+  const uint32_t order[] = {2, 5, 4, 6};
+  Sample s;
+  for (uint32_t ts : order) {
+    TEST_ASSERT_TRUE(q.peek(s));
+    TEST_ASSERT_EQUAL_UINT32(ts, s.ts);
+    q.pop();
+  }
+}
+
+// Só alertas na fila: a normal nova fica de fora, um alerta novo tira o
+// alerta mais antigo
+void test_full_of_alerts() {
+  SampleQueue<3> q;
+  q.push(fever(1));
+  q.push(fever(2));
+  q.push(tachy(3));
+  TEST_ASSERT_FALSE(q.push(normal(4)));
+  TEST_ASSERT_EQUAL(1, q.droppedNormal());
+  TEST_ASSERT_FALSE(q.push(fever(5)));
+  TEST_ASSERT_EQUAL(1, q.droppedAlert());
+  TEST_ASSERT_EQUAL(3, q.alerts());
+  Sample s;
+  TEST_ASSERT_TRUE(q.peek(s));
+  TEST_ASSERT_EQUAL_UINT32(2, s.ts);
+}
+
+void test_pop_evictable_takes_discard_order() {
+  SampleQueue<4> q;
+  q.push(fever(1));
+  q.push(normal(2));
+  q.push(normal(3));
+  Sample s;
+  TEST_ASSERT_TRUE(q.popEvictable(s));
+  TEST_ASSERT_EQUAL_UINT32(2, s.ts);
+  TEST_ASSERT_TRUE(q.popEvictable(s));
+  TEST_ASSERT_EQUAL_UINT32(3, s.ts);
+  TEST_ASSERT_TRUE(q.popEvictable(s));
+  TEST_ASSERT_EQUAL_UINT32(1, s.ts);
+  TEST_ASSERT_FALSE(q.popEvictable(s));
+}
+
+// Tráfego misto aleatório (rajadas de alerta, drains parciais) contra o
+// modelo: mesma saída, mesmos descartes e estrutura sempre válida
+void test_mixed_traffic_matches_model() {
+  static const size_t N = 32;
+  SampleQueue<N> q;
+  std::deque<Sample> mAlert, mNormal;
+  uint32_t mDropNormal = 0, mDropAlert = 0;
+  std::mt19937 rng(7);
+  uint32_t ts = 0;
+  for (int step = 0; step < 200000; step++) {
+    uint32_t r = rng() % 100;
+    if (r < 70) {
+      // Alertas em rajadas: metade do tempo ~40%, metade ~5%
+      bool burst = (step / 500) % 2 == 0;
+      bool alert = rng() % 100 < (burst ? 40u : 5u);
+      Sample s = alert ? (rng() % 2 ? fever(++ts) : tachy(++ts)) : normal(++ts);
+      bool full = mAlert.size() + mNormal.size() == N;
+      if (full && !alert && mNormal.empty()) mDropNormal++;   // a nova fica de fora
+      else {
+        if (full && !mNormal.empty()) { mNormal.pop_front(); mDropNormal++; }
+        else if (full) { mAlert.pop_front(); mDropAlert++; }
+        (alert ? mAlert : mNormal).push_back(s);
+      }
+      TEST_ASSERT_EQUAL(!full, q.push(s));
+    } else if (r < 95) {
+      Sample s;
+      bool has = q.peek(s);
+      std::deque<Sample>& m = mAlert.empty() ? mNormal : mAlert;
+      TEST_ASSERT_EQUAL(!m.empty(), has);
+      if (!has) continue;
+      TEST_ASSERT_EQUAL_UINT32(m.front().ts, s.ts);
+      m.pop_front();
+      q.pop();
+    } else {
+      Sample s;
+      std::deque<Sample>& m = mNormal.empty() ? mAlert : mNormal;
+      TEST_ASSERT_EQUAL(!m.empty(), q.popEvictable(s));
+      if (m.empty()) continue;
+      TEST_ASSERT_EQUAL_UINT32(m.front().ts, s.ts);
+      m.pop_front();
+    }
+    TEST_ASSERT_EQUAL(mAlert.size() + mNormal.size(), q.size());
+    TEST_ASSERT_EQUAL(mAlert.size(), q.alerts());
+    TEST_ASSERT_EQUAL_UINT32(mDropNormal, q.droppedNormal());
+    TEST_ASSERT_EQUAL_UINT32(mDropAlert, q.droppedAlert());
+    if (step % 997 == 0) TEST_ASSERT_TRUE(q.valid());
+  }
+  TEST_ASSERT_TRUE(q.valid());
+  TEST_ASSERT_GREATER_THAN(0, mDropAlert);
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_alerts_leave_first_in_arrival_order);
+  RUN_TEST(test_full_drops_oldest_normal_first);
+  RUN_TEST(test_full_of_alerts);
+  RUN_TEST(test_pop_evictable_takes_discard_order);
+  RUN_TEST(test_mixed_traffic_matches_model);
+  return UNITY_END();
+}
@@ -0,0 +1,147 @@
+// Formato binário (sample_wire.h): ida e volta exata do lote, inclusive
+// com o ts passando pela volta do millis(), leituras NaN e deltas
+// extremos; tamanho dentro de wireBatchMax() e lote truncado recusado;
+// envelope da entrega (v2).
+#include <unity.h>
+#include <string.h>
+#include <random>
+#include <vector>
+#include "sample.h"
+#include "sample_wire.h"
+
+static const size_t N = 60;   // FLUSH_BATCH_MAX_SAMPLES
+
+static void assertRoundTrip(const std::vector<Sample>& in) {
+  std::vector<uint8_t> buf(wireBatchMax(in.size()));
+  size_t len = wireEncodeBatch(in.data(), in.size(), buf.data());
+  TEST_ASSERT_LESS_OR_EQUAL(wireBatchMax(in.size()), len);
+  std::vector<Sample> out(in.size() + 1);
+  TEST_ASSERT_EQUAL((int)in.size(), wireDecodeBatch(buf.data(), len, out.data(), out.size()));
+  if (!in.empty()) TEST_ASSERT_EQUAL_MEMORY(in.data(), out.data(), in.size() * sizeof(Sample));
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_windows_round_trip() {
+  std::vector<Sample> in;
+  for (uint32_t i = 0; i < N; i++) {
+    in.push_back(makeSample(10000 + i * 10000, 36.5f + (i % 7) * 0.1f, 55.0f - (i % 5) * 0.3f, 70 + (int)(i % 9),
+                            i % 3 != 0));
+  }
+  assertRoundTrip(in);
+  std::vector<uint8_t> buf(wireBatchMax(N));
+  size_t len = wireEncodeBatch(in.data(), N, buf.data());
+  TEST_ASSERT_LESS_THAN(8 * N, len);   // ~6 bytes por janela típica
+}
+
+// millis() dá a volta (~49,7 dias) no meio do lote
+void test_ts_wrap_round_trip() {
+  std::vector<Sample> in;
+  uint32_t ts = UINT32_MAX - 5 * 10000 + 1234;
+  for (size_t i = 0; i < N; i++, ts += 10000) in.push_back(makeSample(ts, 36.5f, 55.0f, 75, true));
+  TEST_ASSERT_LESS_THAN(in.front().ts, in.back().ts);   // voltou
+  assertRoundTrip(in);
+  // Envelope de flash/RAM: amostra antiga depois de uma nova (alerta antes)
+  in = {makeSample(100, 36.5f, 55.0f, 75, true), makeSample(UINT32_MAX - 50, 39.0f, 55.0f, 75, true),
+        makeSample(5, 36.5f, 55.0f, 75, true)};
+  assertRoundTrip(in);
+}
+
+void test_nan_and_extremes_round_trip() {
+  std::vector<Sample> in = {
+    makeSample(0, NAN, NAN, 0, false),
+    makeSample(UINT32_MAX, -327.68f, 0.0f, 65535, true),
+    makeSample(0, 327.67f, 655.35f, 0, false),
+    makeSample(1, NAN, 655.35f, 65535, true),
+    makeSample(2, -327.68f, NAN, 0, true),
+    makeSample(3, 0.0f, 0.0f, 1, false),
+  };
+  assertRoundTrip(in);
+}
+
+void test_random_batches_round_trip() {
+  std::mt19937 rng(5);
+  for (int b = 0; b < 2000; b++) {
+    std::vector<Sample> in(rng() % (N + 1));
+    for (Sample& s : in) {
+      s.ts = rng();
+      s.temp = (int16_t)rng();
+      s.hum = (uint16_t)rng();
+      s.bpm = (uint16_t)rng();
+      s.flags = (uint8_t)(rng() & 0x1F);
+      if (s.flags & SAMPLE_F_TEMP_NAN) s.temp = 0;
+      if (s.flags & SAMPLE_F_HUM_NAN) s.hum = 0;
+    }
+    assertRoundTrip(in);
+  }
+}
+
+// Qualquer prefixo do lote, versão errada ou n acima do máximo: -1
+void test_truncated_or_invalid_rejected() {
+  std::vector<Sample> in;
+  for (uint32_t i = 0; i < 10; i++) in.push_back(makeSample(UINT32_MAX - i * 7919, 36.5f + i, NAN, 75, true));
+  std::vector<uint8_t> buf(wireBatchMax(in.size()));
+  size_t len = wireEncodeBatch(in.data(), in.size(), buf.data());
+  Sample out[10];
+  for (size_t n = 0; n < len; n++) TEST_ASSERT_EQUAL(-1, wireDecodeBatch(buf.data(), n, out, 10));
+  TEST_ASSERT_EQUAL(-1, wireDecodeBatch(buf.data(), len, out, 9));
+  buf[0] = WIRE_VERSION_ENVELOPE + 1;
+  TEST_ASSERT_EQUAL(-1, wireDecodeBatch(buf.data(), len, out, 10));
+}
+
+// Envelope da entrega (v2): boot/seq/base voltam iguais, inclusive perto do
+// wrap do seq; v1 não mexe no envelope; prefixos recusados
+void test_envelope_round_trip() {
+  std::vector<Sample> in;
+  for (uint32_t i = 0; i < 5; i++) in.push_back(makeSample(10000 + i * 10000, 36.5f, 55.0f, 72, true));
+  const WireEnvelope env = {0xDEADBEEF, UINT32_MAX - 2, UINT32_MAX - 7};
+  std::vector<uint8_t> buf(wireBatchMax(in.size()));
+  size_t len = wireEncodeBatch(in.data(), in.size(), buf.data(), &env);
+  TEST_ASSERT_LESS_OR_EQUAL(wireBatchMax(in.size()), len);
+  TEST_ASSERT_EQUAL(WIRE_VERSION_ENVELOPE, buf[0]);
+  Sample out[5];
+  WireEnvelope got = {0, 0, 0};
+  TEST_ASSERT_EQUAL(5, wireDecodeBatch(buf.data(), len, out, 5, &got));
+  TEST_ASSERT_EQUAL_MEMORY(in.data(), out, sizeof(out));
+  TEST_ASSERT_EQUAL_UINT32(env.boot, got.boot);
+  TEST_ASSERT_EQUAL_UINT32(env.seq, got.seq);
+  TEST_ASSERT_EQUAL_UINT32(env.base, got.base);
+  for (size_t n = 0; n < len; n++) TEST_ASSERT_EQUAL(-1, wireDecodeBatch(buf.data(), n, out, 5, &got));
+
+  WireEnvelope untouched = {1, 2, 3};
+  len = wireEncodeBatch(in.data(), in.size(), buf.data());
+  TEST_ASSERT_EQUAL(5, wireDecodeBatch(buf.data(), len, out, 5, &untouched));
+  TEST_ASSERT_EQUAL_UINT32(2, untouched.seq);
+}
+
+void test_zigzag_and_varint_edges() {
+  const int32_t values[] = {0, -1, 1, 63, -64, 64, 65535, -65536, INT32_MAX, INT32_MIN};
+  for (int32_t v : values) TEST_ASSERT_EQUAL_INT32(v, wireUnzigzag(wireZigzag(v)));
+  const uint32_t raw[] = {0, 127, 128, 16383, 16384, UINT32_MAX};
+  for (uint32_t v : raw) {
+    uint8_t buf[5];
+    uint8_t* end = wirePutVarint(buf, v);
+    const uint8_t* p = buf;
+    uint32_t got;
+    TEST_ASSERT_TRUE(wireGetVarint(p, end, got));
+    TEST_ASSERT_EQUAL_UINT32(v, got);
+    TEST_ASSERT_TRUE(p == end);
+  }
+  const uint8_t endless[6] = {0x80, 0x80, 0x80, 0x80, 0x80, 0x01};
+  const uint8_t* p = endless;
+  uint32_t got;
+  TEST_ASSERT_FALSE(wireGetVarint(p, endless + sizeof(endless), got));
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_windows_round_trip);
+  RUN_TEST(test_ts_wrap_round_trip);
+  RUN_TEST(test_nan_and_extremes_round_trip);
+  RUN_TEST(test_random_batches_round_trip);
+  RUN_TEST(test_truncated_or_invalid_rejected);
+  RUN_TEST(test_envelope_round_trip);
+  RUN_TEST(test_zigzag_and_varint_edges);
+  return UNITY_END();
+}
@@ -0,0 +1,183 @@
+// Agenda de prazos (scheduler.h) com o relógio passando por 0xFFFFFFFF:
+// ordem de execução, at/after/atMost/cancel, períodos e nextDueIn() na
+// volta do millis(), e um modelo com tempo de 64 bits conferindo sequências
+// aleatórias de operações.
+#include <unity.h>
+#include <random>
+#include <vector>
+#include "scheduler.h"
+
+static const uint32_t NEAR_WRAP = 0xFFFFFFFFu - 500;
+
+typedef Scheduler<8> Sched;
+static std::vector<int> fired;
+
+template <int I>
+static void fire() {
+  fired.push_back(I);
+}
+
+static const SchedJobFn FNS[8] = {fire<0>, fire<1>, fire<2>, fire<3>, fire<4>, fire<5>, fire<6>, fire<7>};
+
+// Chama runDue() a cada ms de from até to (inclusive, com wrap)
+static size_t runEachMs(Sched& s, uint32_t from, uint32_t to) {
+  size_t ran = 0;
+  for (uint32_t now = from;; now++) {
+    ran += s.runDue(now);
+    if (now == to) return ran;
+  }
+}
+
+void setUp() { fired.clear(); }
+void tearDown() {}
+
+void test_order_across_wrap() {
+  Sched s;
+  for (int i = 0; i < 4; i++) s.add(FNS[i]);
+  s.at(0, NEAR_WRAP + 800);   // depois da volta (= 299)
+  s.at(1, NEAR_WRAP + 100);
+  s.at(2, NEAR_WRAP + 501);   // = 0
+  s.after(3, NEAR_WRAP, 400);
+  TEST_ASSERT_EQUAL_UINT32(100, s.nextDueIn(NEAR_WRAP));
+  runEachMs(s, NEAR_WRAP, NEAR_WRAP + 1000);
+  const int want[] = {1, 3, 2, 0};
+  TEST_ASSERT_EQUAL(4, fired.size());
+  TEST_ASSERT_EQUAL_INT_ARRAY(want, fired.data(), 4);
+  TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, s.nextDueIn(NEAR_WRAP + 1000));
+}
+
+// Prazo do outro lado da volta: nem cedo nem tarde, e o atraso medido certo
+void test_due_and_late_across_wrap() {
+  Sched s;
+  s.add(FNS[0]);
+  s.after(0, NEAR_WRAP, 1000);   // = 499
+  TEST_ASSERT_EQUAL_UINT32(1000, s.nextDueIn(NEAR_WRAP));
+  TEST_ASSERT_EQUAL_UINT32(1, s.nextDueIn(498));
+  TEST_ASSERT_EQUAL(0, s.runDue(0xFFFFFFFFu));
+  TEST_ASSERT_EQUAL(0, s.runDue(498));
+  TEST_ASSERT_EQUAL_UINT32(0, s.nextDueIn(520));
+  TEST_ASSERT_EQUAL(1, s.runDue(520));
+  TEST_ASSERT_EQUAL_UINT32(21, s.lateMs());
+  TEST_ASSERT_FALSE(s.armed(0));
+}
+
+void test_at_most_only_moves_earlier() {
+  Sched s;
+  s.add(FNS[0]);
+  s.atMost(0, NEAR_WRAP, 2000);   // desarmado: arma
+  TEST_ASSERT_EQUAL_UINT32(2000, s.nextDueIn(NEAR_WRAP));
+  s.atMost(0, NEAR_WRAP, 3000);   // depois: fica
+  TEST_ASSERT_EQUAL_UINT32(2000, s.nextDueIn(NEAR_WRAP));
+  s.atMost(0, NEAR_WRAP + 600, 100);   // depois da volta, mas antes: antecipa
+  TEST_ASSERT_EQUAL_UINT32(700, s.nextDueIn(NEAR_WRAP));
+  s.after(0, NEAR_WRAP, 5000);   // after() move para qualquer lado
+  TEST_ASSERT_EQUAL_UINT32(5000, s.nextDueIn(NEAR_WRAP));
+}
+
+void test_cancel_keeps_heap_order() {
+  Sched s;
+  for (int i = 0; i < 8; i++) s.add(FNS[i]);
+  for (int i = 0; i < 8; i++) s.at((uint8_t)i, NEAR_WRAP + 100 * (uint32_t)(8 - i));
+  s.cancel(7);   // o topo
+  s.cancel(3);   // do meio
+  s.cancel(3);   // desarmado: nada
+  TEST_ASSERT_FALSE(s.armed(3));
+  TEST_ASSERT_EQUAL_UINT32(200, s.nextDueIn(NEAR_WRAP));
+  runEachMs(s, NEAR_WRAP, NEAR_WRAP + 1000);
+  const int want[] = {6, 5, 4, 2, 1, 0};
+  TEST_ASSERT_EQUAL(6, fired.size());
+  TEST_ASSERT_EQUAL_INT_ARRAY(want, fired.data(), 6);
+}
+
+// Cadência fixa atravessando a volta; atrasado além de um período,
+// ressincroniza em now + período
+void test_periodic_across_wrap() {
+  Sched s;
+  s.add(FNS[0], 100);
+  s.at(0, NEAR_WRAP + 50);
+  TEST_ASSERT_EQUAL(10, runEachMs(s, NEAR_WRAP, NEAR_WRAP + 1049));
+  TEST_ASSERT_EQUAL_UINT32(1, s.nextDueIn(NEAR_WRAP + 1049));
+  TEST_ASSERT_EQUAL(1, s.runDue(NEAR_WRAP + 1400));
+  TEST_ASSERT_EQUAL_UINT32(350, s.lateMs());
+  TEST_ASSERT_EQUAL_UINT32(100, s.nextDueIn(NEAR_WRAP + 1400));
+}
+
+// Rearmado para já dentro do próprio job: roda na chamada seguinte
+static Sched* selfSched = nullptr;
+static void rearmNow() {
+  fired.push_back(9);
+  selfSched->at(0, 0);
+}
+
+void test_rearm_inside_job_waits_for_next_call() {
+  Sched s;
+  selfSched = &s;
+  s.add(rearmNow);
+  s.at(0, 0xFFFFFFFFu);
+  TEST_ASSERT_EQUAL(1, s.runDue(0));
+  TEST_ASSERT_EQUAL(1, s.runDue(0));
+  TEST_ASSERT_EQUAL(2, fired.size());
+}
+
+// Operações aleatórias contra um modelo em 64 bits (sem wrap): a cada ms,
+// os mesmos jobs vencem, na mesma ordem de prazo
+void test_random_ops_match_model() {
+  std::mt19937 rng(23);
+  Sched s;
+  for (int i = 0; i < 8; i++) s.add(FNS[i]);
+  const uint64_t base = (uint64_t)NEAR_WRAP - 20000;
+  std::vector<int64_t> due(8, -1);   // -1 = desarmado
+  uint64_t now = base;
+  for (int step = 0; step < 200000; step++) {
+    uint8_t id = (uint8_t)(rng() % 8);
+    uint32_t delay = rng() % 3000;
+    switch (rng() % 8) {
+      case 0:
+        s.after(id, (uint32_t)now, delay);
+        due[id] = (int64_t)(now + delay);
+        break;
+      case 1:
+        if (due[id] < 0 || (int64_t)(now + delay) < due[id]) due[id] = (int64_t)(now + delay);
+        s.atMost(id, (uint32_t)now, delay);
+        break;
+      case 2:
+        s.cancel(id);
+        due[id] = -1;
+        break;
+      default:
+        break;
+    }
+    now += rng() % 4;
+    fired.clear();
+    s.runDue((uint32_t)now);
+    // Vencem exatamente os do modelo, em ordem de prazo (empates em qualquer ordem)
+    size_t want = 0;
+    for (int i = 0; i < 8; i++) want += due[i] >= 0 && due[i] <= (int64_t)now;
+    TEST_ASSERT_EQUAL(want, fired.size());
+    int64_t last = 0;
+    for (int id : fired) {
+      TEST_ASSERT_TRUE(due[id] >= last && due[id] <= (int64_t)now);
+      last = due[id];
+      due[id] = -1;
+    }
+    int64_t nextDue = -1;
+    for (int i = 0; i < 8; i++) {
+      if (due[i] >= 0 && (nextDue < 0 || due[i] < nextDue)) nextDue = due[i];
+    }
+    uint32_t in = s.nextDueIn((uint32_t)now);
+    TEST_ASSERT_EQUAL_UINT32(nextDue < 0 ? UINT32_MAX : (uint32_t)(nextDue - (int64_t)now), in);
+  }
+  TEST_ASSERT_TRUE(now > (uint64_t)0xFFFFFFFFu);   // passou pela volta
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_order_across_wrap);
+  RUN_TEST(test_due_and_late_across_wrap);
+  RUN_TEST(test_at_most_only_moves_earlier);
+  RUN_TEST(test_cancel_keeps_heap_order);
+  RUN_TEST(test_periodic_across_wrap);
+  RUN_TEST(test_rearm_inside_job_waits_for_next_call);
+  RUN_TEST(test_random_ops_match_model);
+  return UNITY_END();
+}
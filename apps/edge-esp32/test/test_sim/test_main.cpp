@@ -0,0 +1,222 @@
+// Cenários de ponta a ponta no ambiente native: setup()/loop() no relógio
+// virtual, broker em memória e o consumidor simulado (sim_consumer.h)
+// confirmando os envelopes. Um único setup() por processo, então os testes
+// rodam em sequência sobre o mesmo dispositivo e comparam deltas. O relógio
+// começa WRAP_LEAD_MS antes da volta do millis().
+#include <unity.h>
+#include "hal_native.h"
+#include "sim_consumer.h"
+
+void setup();
+void loop();
+size_t backlogSize();
+void ramBacklogRestore();
+
+static const uint32_t WINDOW_MS = 10000;
+static const uint32_t DHT_INTERVAL_MS = 2000;
+static const uint32_t WRAP_LEAD_MS = 30000;
+static const uint32_t MQTT_BACKOFF_MAX_MS = 30000;
+
+static void runMs(uint32_t ms) {
+  uint64_t endUs = sim::nowUs() + (uint64_t)ms * 1000;
+  while (sim::nowUs() < endUs) {
+    uint64_t before = sim::nowUs();
+    loop();
+    if (sim::nowUs() == before) sim::advanceMs(1);
+  }
+}
+
+// Sem perda, cada janela entre a primeira e a última chegou: compara as
+// janelas distintas recebidas com o intervalo coberto
+static void assertNoLoss() {
+  const SimConsumer& c = simConsumer;
+  TEST_ASSERT_EQUAL((c.lastTs - c.firstTs + WINDOW_MS / 2) / WINDOW_MS + 1, c.seenTs.size());
+}
+
+// Derruba a conexão quando o primeiro envelope do drain chega ao broker
+static bool dropArmed = false;
+// Node-RED fora do ar: descarta tudo e volta, sem o estado de deduplicação,
+// num envelope que não começa no base (janela nova com outras sem ack)
+static bool consumerDown = false;
+
+static void receiveHook(const sim::Message& msg) {
+  bool vitals = msg.topic == "cardioia/ana/v1/vitals";
+  if (consumerDown) {
+    if (!vitals) return;
+    std::string p(msg.payload.begin(), msg.payload.end());
+    unsigned long boot, seq, base;
+    if (sscanf(p.c_str(), "{\"boot\":%lu,\"seq\":%lu,\"base\":%lu", &boot, &seq, &base) != 3 || seq == base) return;
+    consumerDown = false;
+    simConsumer.restart();
+  }
+  simConsumerReceive(msg);
+  if (!dropArmed || !vitals) return;
+  dropArmed = false;
+  sim::scheduleAt(sim::nowUs() + 1000, [] { sim::dropMqtt(); });
+}
+
+// Reset no meio do PUBLISH: guarda a RAM retida como ela está durante o envio
+static const char* const NOINIT_PATH = "test_sim_noinit.bin";
+static bool resetArmed = false;
+static size_t backlogAtReset = 0;
+
+static void publishHook(const char* topic) {
+  if (!resetArmed || strcmp(topic, "cardioia/ana/v1/vitals") != 0) return;
+  resetArmed = false;
+  backlogAtReset = backlogSize();
+  sim::saveNoinit(NOINIT_PATH);
+}
+
+void setUp() {}
+void tearDown() {}
+
+// Broker fora do ar atravessando a volta do millis(): as janelas continuam
+// fechando a cada WINDOW_MS, o backoff da reconexão continua no teto e,
+// com o broker de volta, tudo chega
+void test_wrap_reconnect_and_windows() {
+  const SimConsumer& c = simConsumer;
+  uint32_t m0 = millis();
+  sim::setMqttAvailable(false);
+  sim::serialInput("ONLINE");
+  runMs(WRAP_LEAD_MS + 90000);
+  TEST_ASSERT_TRUE(millis() < m0);   // já passou da volta
+  TEST_ASSERT_EQUAL(0, c.windows);
+  TEST_ASSERT_GREATER_OR_EQUAL((WRAP_LEAD_MS + 90000) / WINDOW_MS - 1, backlogSize());
+  sim::setMqttAvailable(true);
+  uint32_t t0 = millis();
+  while (c.windows == 0 && millis() - t0 < 2 * MQTT_BACKOFF_MAX_MS) runMs(100);
+  TEST_ASSERT_LESS_OR_EQUAL(MQTT_BACKOFF_MAX_MS + 1000, millis() - t0);
+  runMs(30000);
+  TEST_ASSERT_EQUAL(0, backlogSize());
+  TEST_ASSERT_EQUAL(0, c.dups);
+  TEST_ASSERT_TRUE(c.lastTs < c.firstTs);   // as janelas cobrem a volta
+  assertNoLoss();
+}
+
+void test_online_delivers_every_window() {
+  sim::serialInput("ONLINE");
+  runMs(60000);
+  const SimConsumer& c = simConsumer;
+  TEST_ASSERT_GREATER_OR_EQUAL(5, c.samples);
+  TEST_ASSERT_EQUAL(0, c.dups);
+  TEST_ASSERT_EQUAL(0, c.gaps);
+  assertNoLoss();
+  TEST_ASSERT_EQUAL(0, backlogSize());
+}
+
+void test_offline_backlog_delivered_after_reconnect() {
+  const SimConsumer& c = simConsumer;
+  unsigned long before = c.windows;
+  sim::serialInput("OFFLINE");
+  runMs(120000);
+  TEST_ASSERT_EQUAL(before, c.windows);
+  TEST_ASSERT_GREATER_OR_EQUAL(11, backlogSize());
+  sim::serialInput("ONLINE");
+  runMs(30000);
+  TEST_ASSERT_EQUAL(0, backlogSize());
+  TEST_ASSERT_EQUAL(0, c.dups);
+  assertNoLoss();
+}
+
+// Queda com o drain em voo: o que não teve ack é reenviado e as duplicadas
+// são descartadas pelo seq
+void test_drop_mid_drain_loses_nothing() {
+  const SimConsumer& c = simConsumer;
+  unsigned long dups = c.dups;
+  sim::setLinkDelayUs(25000);
+  sim::serialInput("OFFLINE");
+  runMs(120000);
+  dropArmed = true;
+  sim::serialInput("ONLINE");
+  runMs(30000);
+  sim::setLinkDelayUs(0);
+  TEST_ASSERT_GREATER_THAN(dups, c.dups);
+  TEST_ASSERT_EQUAL(0, backlogSize());
+  assertNoLoss();
+}
+
+// Node-RED reiniciado sem o estado de deduplicação, com mensagens sem ack:
+// retoma no base do envelope em vez de aceitar a partir do seq e perder o
+// que ficou antes
+void test_consumer_restart_resumes_at_base() {
+  consumerDown = true;
+  runMs(60000);
+  TEST_ASSERT_FALSE(consumerDown);
+  TEST_ASSERT_LESS_OR_EQUAL(1, backlogSize());   // a janela que acabou de fechar
+  assertNoLoss();
+}
+
+// Febre: o tópico de alertas chega na leitura seguinte do DHT, a janela no
+// fechamento seguinte
+void test_alert_reaches_consumer() {
+  SimConsumer& c = simConsumer;
+  unsigned long msgs = c.alertMsgs;
+  sim::setDht(39.0f, 55.0f);
+  c.inject(false, true);
+  runMs(WINDOW_MS + 5000);
+  TEST_ASSERT_EQUAL(msgs + 1, c.alertMsgs);
+  TEST_ASSERT_LESS_OR_EQUAL(DHT_INTERVAL_MS + 100, c.topicMs);
+  TEST_ASSERT_LESS_OR_EQUAL(WINDOW_MS + 1000, c.windowMs);
+  sim::setDht(36.5f, 55.0f);
+  c.inject(false, false);
+  runMs(WINDOW_MS + 5000);
+  TEST_ASSERT_EQUAL(msgs + 2, c.alertMsgs);
+}
+
+// Alerta gerado offline fica retido e sai na reconexão
+void test_alert_held_while_offline() {
+  SimConsumer& c = simConsumer;
+  unsigned long msgs = c.alertMsgs;
+  sim::serialInput("OFFLINE");
+  runMs(1000);
+  sim::setDht(39.0f, 55.0f);
+  c.inject(false, true);
+  runMs(20000);
+  TEST_ASSERT_EQUAL(msgs, c.alertMsgs);
+  sim::serialInput("ONLINE");
+  runMs(5000);
+  TEST_ASSERT_EQUAL(msgs + 1, c.alertMsgs);
+  TEST_ASSERT_GREATER_OR_EQUAL(20000, c.topicMs);
+  sim::setDht(36.5f, 55.0f);
+  runMs(WINDOW_MS);
+}
+
+// Reset durante o publish do drain: o estado retido já está selado com o
+// lote na janela, então o boot seguinte o restaura inteiro e o reenvia
+void test_reset_during_publish_keeps_backlog() {
+  sim::serialInput("OFFLINE");
+  runMs(60000);
+  TEST_ASSERT_GREATER_OR_EQUAL(5, backlogSize());
+  resetArmed = true;
+  sim::serialInput("ONLINE");
+  for (int ms = 0; resetArmed && ms < 60000; ms++) runMs(1);
+  TEST_ASSERT_FALSE(resetArmed);
+  TEST_ASSERT_GREATER_OR_EQUAL(5, backlogAtReset);
+  // Boot novo sobre a RAM de então (só o backlog; o resto segue igual)
+  TEST_ASSERT_EQUAL(sim::noinitSize(), sim::loadNoinit(NOINIT_PATH));
+  remove(NOINIT_PATH);
+  ramBacklogRestore();
+  TEST_ASSERT_EQUAL(backlogAtReset, backlogSize());
+  runMs(30000);
+  TEST_ASSERT_EQUAL(0, backlogSize());
+  assertNoLoss();
+}
+
+int main(int, char**) {
+  sim::attachDht(15);
+  sim::onBrokerReceive(receiveHook);
+  sim::onPublish(publishHook);
+  sim::setNowUs(((uint64_t)UINT32_MAX + 1 - WRAP_LEAD_MS) * 1000);
+  setup();
+  sim::startBeats(4, sim::nowUs() + 400000, UINT64_MAX);
+  UNITY_BEGIN();
+  RUN_TEST(test_wrap_reconnect_and_windows);
+  RUN_TEST(test_online_delivers_every_window);
+  RUN_TEST(test_offline_backlog_delivered_after_reconnect);
+  RUN_TEST(test_drop_mid_drain_loses_nothing);
+  RUN_TEST(test_consumer_restart_resumes_at_base);
+  RUN_TEST(test_alert_reaches_consumer);
+  RUN_TEST(test_alert_held_while_offline);
+  RUN_TEST(test_reset_during_publish_keeps_backlog);
+  return UNITY_END();
+}